@@ -0,0 +1,323 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "define.h"
+#include "batch.h"
+#include "beam.h"
+#include "bundle.h"
+#include "input.h"
+#include "lns.h"
+#include "presolve.h"
+#include "problem.h"
+#include "solution.h"
+#include "solve.h"
+#include "timer.h"
+
+typedef struct {
+  int n_instance;
+  char **filename;
+  /* the instances are taken from bundle instead if it is not NULL */
+  bundle_t *bundle;
+  /* arguments of read_file() */
+  int n_stack;
+  int s_height;
+  int n_empty_tier;
+  /* next instance to be solved */
+  int next;
+  pthread_mutex_t mutex;
+} batch_t;
+
+static void batch_add(char ***, int *, int *, char *);
+static int batch_comp(const void *, const void *);
+static void *batch_worker(void *);
+static void batch_solve(batch_t *, solver_ctx_t *, char *, problem_t *);
+
+/*
+ * solve the instances in directory list, those whose files are listed
+ * in file list ("-": standard input), or those in bundle list by
+ * n_thread workers.
+ * every worker keeps a solver context, so that the working area of
+ * the search is reused among its instances.  one line is written to
+ * stdout for every instance in the order of completion.
+ *
+ */
+int batch(char *list, int n_stack, int s_height, int n_empty_tier)
+{
+  int i;
+  int n_worker;
+  batch_t batch;
+  pthread_t *thread;
+
+  batch.filename = NULL;
+  batch.bundle = NULL;
+  if(is_bundle(list) == True) {
+    if((batch.bundle = open_bundle(list)) == NULL) {
+      return(1);
+    }
+    batch.n_instance = batch.bundle->n_instance;
+  } else if((batch.n_instance = batch_list(list, &(batch.filename))) < 0) {
+    return(1);
+  }
+
+  batch.n_stack = n_stack;
+  batch.s_height = s_height;
+  batch.n_empty_tier = n_empty_tier;
+  batch.next = 0;
+  pthread_mutex_init(&(batch.mutex), NULL);
+
+  n_worker = setup_workers();
+
+  thread = (pthread_t *) malloc((size_t) n_worker*sizeof(pthread_t));
+  for(i = 0; i < n_worker; ++i) {
+    pthread_create(&(thread[i]), NULL, batch_worker, (void *) &batch);
+  }
+  for(i = 0; i < n_worker; ++i) {
+    pthread_join(thread[i], NULL);
+  }
+
+  free(thread);
+  pthread_mutex_destroy(&(batch.mutex));
+  if(batch.bundle != NULL) {
+    close_bundle(batch.bundle);
+  } else {
+    for(i = 0; i < batch.n_instance; ++i) {
+      free(batch.filename[i]);
+    }
+    free(batch.filename);
+  }
+
+  return(0);
+}
+
+/*
+ * set up the solver for instances solved concurrently by n_thread
+ * workers, and return the number of workers
+ *
+ */
+int setup_workers(void)
+{
+  int n_worker = n_thread;
+
+  /* the instances are solved in parallel instead of the heuristics */
+  n_thread = 1;
+  if(n_worker > 1) {
+    /* the cpu time of the process is shared by the workers */
+    wall_clock = True;
+  }
+
+  return(n_worker);
+}
+
+/*
+ * file names of the instances in directory list (sorted by name) or
+ * in file list (one per line)
+ *
+ */
+int batch_list(char *list, char ***filename)
+{
+  int n = 0, size = 0;
+  char buf[MAXBUFLEN], *p;
+  struct stat st;
+
+  *filename = NULL;
+
+  if(strcmp(list, "-") != 0 && stat(list, &st) == 0 && S_ISDIR(st.st_mode)) {
+    DIR *dir;
+    struct dirent *entry;
+
+    if((dir = opendir(list)) == NULL) {
+      fprintf(stderr, "Failed to open directory: %s\n", list);
+      return(-1);
+    }
+
+    while((entry = readdir(dir)) != NULL) {
+      if(entry->d_name[0] == '.') {
+        continue;
+      }
+      snprintf(buf, MAXBUFLEN, "%s/%s", list, entry->d_name);
+      if(stat(buf, &st) == 0 && S_ISREG(st.st_mode)) {
+        batch_add(filename, &n, &size, buf);
+      }
+    }
+    closedir(dir);
+
+    qsort((void *) *filename, n, sizeof(char *), batch_comp);
+  } else {
+    FILE *fp;
+
+    if(strcmp(list, "-") == 0) {
+      fp = stdin;
+    } else if((fp = fopen(list, "r")) == NULL) {
+      fprintf(stderr, "Failed to open file: %s\n", list);
+      return(-1);
+    }
+
+    while(fgets(buf, MAXBUFLEN, fp) != NULL) {
+      for(p = buf; *p == ' ' || *p == '\t'; ++p);
+      p[strcspn(p, "\r\n")] = '\0';
+      if(*p != '\0' && *p != '#') {
+        batch_add(filename, &n, &size, p);
+      }
+    }
+
+    if(fp != stdin) {
+      fclose(fp);
+    }
+  }
+
+  return(n);
+}
+
+void batch_add(char ***filename, int *n, int *size, char *name)
+{
+  if(*n == *size) {
+    *size = max(2*(*size), 64);
+    *filename = (char **) realloc((void *) *filename,
+                                  (size_t) *size*sizeof(char *));
+  }
+
+  (*filename)[(*n)++] = strdup(name);
+}
+
+int batch_comp(const void *a, const void *b)
+{
+  return(strcmp(*((char **) a), *((char **) b)));
+}
+
+void *batch_worker(void *arg)
+{
+  int i;
+  batch_t *batch = (batch_t *) arg;
+  solver_ctx_t *ctx = create_solver_ctx();
+  problem_t *problem, *view = NULL;
+
+  if(batch->bundle != NULL) {
+    view = create_problem_view(batch->bundle);
+  }
+
+  while(True) {
+    pthread_mutex_lock(&(batch->mutex));
+    i = batch->next++;
+    pthread_mutex_unlock(&(batch->mutex));
+
+    if(i >= batch->n_instance) {
+      break;
+    }
+
+    if(batch->bundle != NULL) {
+      batch_solve(batch, ctx, bundle_name(batch->bundle, i),
+                  problem_view(batch->bundle, view, i));
+    } else {
+      problem = read_file(batch->filename[i], batch->n_stack,
+                          batch->s_height, batch->n_empty_tier);
+      batch_solve(batch, ctx, batch->filename[i], problem);
+      free_problem(problem);
+    }
+  }
+
+  free_problem_view(view);
+  free_solver_ctx(ctx);
+
+  return(NULL);
+}
+
+/*
+ * the same steps as main()
+ * (problem == NULL: the instance failed to be read)
+ *
+ */
+void batch_solve(batch_t *batch, solver_ctx_t *ctx, char *filename,
+                 problem_t *problem)
+{
+  int lb = -1;
+  uchar ret;
+  problem_t *reduced = NULL;
+  solution_t *solution;
+
+  if(problem == NULL) {
+    pthread_mutex_lock(&(batch->mutex));
+    fprintf(stdout, "%s error\n", filename);
+    fflush(stdout);
+    pthread_mutex_unlock(&(batch->mutex));
+    return;
+  }
+
+  solution = create_solution();
+
+  timer_start(problem);
+
+  if(presolve_mode == True) {
+    reduced = presolve(problem);
+  }
+
+  if(beam_width > 0) {
+    ret = beam_search((reduced != NULL)?reduced:problem, solution);
+  } else {
+    ret = solve_ctx(ctx, (reduced != NULL)?reduced:problem, solution);
+    lb = solver_ctx_lower_bound(ctx);
+  }
+
+  if(reduced != NULL) {
+    postsolve(problem, reduced, solution);
+    free_problem(reduced);
+  }
+
+  if(ret != True && lns_window > 0
+     && solution->n_relocation <= MAX_N_RELOCATION) {
+    lns(problem, solution);
+  }
+
+  set_time(problem);
+
+  pthread_mutex_lock(&(batch->mutex));
+  if(solution->n_relocation > MAX_N_RELOCATION) {
+    fprintf(stdout, "%s none", filename);
+  } else {
+    fprintf(stdout, "%s %s=%d", filename, (ret == True)?"opt":"best",
+            solution->n_relocation);
+  }
+  if(lb >= 0) {
+    fprintf(stdout, " lb=%d nodes=%llu", lb, solver_ctx_nodes(ctx));
+  }
+  fprintf(stdout, " time=%.2f\n", problem->time);
+  fflush(stdout);
+  pthread_mutex_unlock(&(batch->mutex));
+
+  free_solution(solution);
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "define.h"
+#include "beam.h"
+#include "heuristics.h"
+#include "pdb.h"
+#include "print.h"
+#include "problem.h"
+#include "solution.h"
+#include "solve.h"
+#include "timer.h"
+
+typedef struct {
+  state_t *state;
+  solution_t *solution;
+} beam_node_t;
+
+typedef struct {
+  int parent;
+  int src;
+  int dst;
+  int lb;
+  int n_misoverlay;
+} beam_child_t;
+
+typedef struct {
+  problem_t *problem;
+  beam_node_t *node;
+  int n_node;
+  beam_child_t *child;
+  int *n_child;
+  int upper_bound;
+  int level;
+} beam_t;
+
+typedef struct {
+  beam_t *beam;
+  int index;
+  solution_t *solution;
+  lb_work_t *lb_work;
+  heuristics_work_t *heuristics_work;
+} beam_worker_t;
+
+static void *beam_worker(void *);
+static int beam_child_comp(const void *, const void *);
+
+/*
+ * beam search
+ * nodes of the same depth are evaluated by depth + lower bound, and
+ * only the best beam_width nodes are expanded.  expansion of the beam
+ * is shared among n_thread workers.  the result is not proven optimal
+ * unless it reaches the lower bound of the root node.
+ *
+ */
+uchar beam_search(problem_t *problem, solution_t *solution)
+{
+  int i, k;
+  int max_n_child = problem->n_stack*(problem->n_stack - 1);
+  int root_lb;
+  beam_t beam;
+  beam_node_t *next_node, *tmp_node;
+  beam_worker_t *worker;
+  pthread_t *thread;
+  state_t *state;
+  lb_state_t *lb_state;
+  lb_work_t *lb_work;
+  heuristics_work_t *heuristics_work;
+  pdb_t *pdb = NULL;
+  block_t block;
+
+  solution->n_relocation = MAX_N_RELOCATION + 1;
+
+  state = initialize_state(problem, NULL);
+  if(state->n_misoverlay == 0) {
+    fprintf(stderr, "No relocation necessary.\n");
+    free_state(state);
+    solution->n_relocation = 0;
+    return(True);
+  }
+
+  if(n_pdb > 0) {
+    /* shared by the workers */
+    pdb = create_pdb(problem, n_pdb, pdb_dir);
+  }
+  lb_work = create_lb_work(problem, pdb);
+  heuristics_work = create_heuristics_work(problem);
+  lb_state = initialize_lb_state(problem, state, NULL);
+  root_lb = lower_bound(lb_work, problem, state, lb_state, MAX_N_RELOCATION,
+                        False);
+  fprintf(stderr, "initial lb=%d\n", root_lb);
+
+  if(lb_state->n_dirty_stack + lb_state->n_full_clean_stack
+     < problem->n_stack) {
+    solution->n_relocation = 0;
+    if(heuristics(heuristics_work, problem, state, solution,
+                  MAX_N_RELOCATION + 1)) {
+      fprintf(stderr, "initial ub=%d ", solution->n_relocation);
+      print_time(problem);
+    }
+  }
+
+  beam.problem = problem;
+  beam.node
+    = (beam_node_t *) malloc((size_t) 2*beam_width*sizeof(beam_node_t));
+  next_node = beam.node + beam_width;
+  for(i = 0; i < 2*beam_width; ++i) {
+    beam.node[i].state = create_state(problem);
+    beam.node[i].solution = create_solution();
+  }
+  beam.child = (beam_child_t *) malloc((size_t) beam_width*max_n_child
+                                       *sizeof(beam_child_t));
+  beam.n_child = (int *) malloc((size_t) beam_width*sizeof(int));
+
+  worker
+    = (beam_worker_t *) malloc((size_t) n_thread*sizeof(beam_worker_t));
+  thread = (pthread_t *) malloc((size_t) n_thread*sizeof(pthread_t));
+  for(i = 0; i < n_thread; ++i) {
+    worker[i].beam = &beam;
+    worker[i].index = i;
+    worker[i].solution = create_solution();
+    worker[i].lb_work = create_lb_work(problem, pdb);
+    worker[i].heuristics_work = create_heuristics_work(problem);
+  }
+
+  copy_state(problem, beam.node[0].state, state);
+  beam.node[0].solution->n_relocation = 0;
+  beam.n_node = 1;
+
+  for(beam.level = 1; beam.n_node > 0 && solution->n_relocation > root_lb
+        && beam.level < solution->n_relocation; ++beam.level) {
+    int n_child = 0;
+
+    if(tlimit > 0 && get_time(problem) >= (double) tlimit) {
+      break;
+    }
+
+    beam.upper_bound = solution->n_relocation;
+
+    if(n_thread == 1) {
+      beam_worker((void *) &(worker[0]));
+    } else {
+      for(i = 0; i < n_thread; ++i) {
+        pthread_create(&(thread[i]), NULL, beam_worker,
+                       (void *) &(worker[i]));
+      }
+      for(i = 0; i < n_thread; ++i) {
+        pthread_join(thread[i], NULL);
+      }
+    }
+
+    for(i = 0; i < n_thread; ++i) {
+      if(worker[i].solution->n_relocation < solution->n_relocation) {
+        copy_solution(solution, worker[i].solution);
+        fprintf(stderr, "ub=%d depth=%d ", solution->n_relocation,
+                beam.level);
+        print_time(problem);
+      }
+    }
+
+    /* collect the children of all the nodes */
+    for(i = 0; i < beam.n_node; ++i) {
+      for(k = 0; k < beam.n_child[i]; ++k) {
+        if(beam.level + beam.child[i*max_n_child + k].lb
+           < solution->n_relocation) {
+          beam.child[n_child++] = beam.child[i*max_n_child + k];
+        }
+      }
+    }
+
+    qsort((void *) beam.child, (size_t) n_child, sizeof(beam_child_t),
+          beam_child_comp);
+
+    /* next beam */
+    if(n_child > beam_width) {
+      n_child = beam_width;
+    }
+    for(k = 0; k < n_child; ++k) {
+      beam_node_t *parent = &(beam.node[beam.child[k].parent]);
+      state_t *cstate = next_node[k].state;
+      int src = beam.child[k].src;
+
+      copy_state(problem, cstate, parent->state);
+      copy_solution(next_node[k].solution, parent->solution);
+      block = cstate->block[src][cstate->stack[src].n_tier - 1];
+      update_state(problem, cstate, src, beam.child[k].dst);
+      add_relocation(next_node[k].solution, src, beam.child[k].dst, &block);
+    }
+
+    tmp_node = beam.node;
+    beam.node = next_node;
+    next_node = tmp_node;
+    beam.n_node = n_child;
+  }
+
+  if(solution->n_relocation <= MAX_N_RELOCATION) {
+    fprintf(stderr, "lb=%d gap=%d\n", root_lb,
+            solution->n_relocation - root_lb);
+  }
+
+  for(i = 0; i < n_thread; ++i) {
+    free_heuristics_work(worker[i].heuristics_work);
+    free_lb_work(worker[i].lb_work);
+    free_solution(worker[i].solution);
+  }
+  free(thread);
+  free(worker);
+  free(beam.n_child);
+  free(beam.child);
+  if(beam.node > next_node) {
+    beam.node = next_node;
+  }
+  for(i = 0; i < 2*beam_width; ++i) {
+    free_solution(beam.node[i].solution);
+    free_state(beam.node[i].state);
+  }
+  free(beam.node);
+  free_lb_state(lb_state);
+  free_heuristics_work(heuristics_work);
+  free_lb_work(lb_work);
+  free_pdb(pdb);
+  free_state(state);
+
+  return((solution->n_relocation == root_lb)?True:False);
+}
+
+void *beam_worker(void *arg)
+{
+  int i, j, k;
+  int max_n_child;
+  beam_worker_t *worker = (beam_worker_t *) arg;
+  beam_t *beam = worker->beam;
+  problem_t *problem = beam->problem;
+  state_t *cstate = create_state(problem);
+  lb_state_t *clb_state = NULL;
+  solution_t *csolution = create_solution();
+  block_t block;
+
+  max_n_child = problem->n_stack*(problem->n_stack - 1);
+  worker->solution->n_relocation = MAX_N_RELOCATION + 1;
+
+  for(k = worker->index; k < beam->n_node; k += n_thread) {
+    beam_node_t *node = &(beam->node[k]);
+    beam_child_t *child = beam->child + k*max_n_child;
+    int last_src = -1, last_dst = -1;
+
+    beam->n_child[k] = 0;
+
+    if(node->solution->n_relocation > 0) {
+      last_src
+        = node->solution->relocation[node->solution->n_relocation - 1].src;
+      last_dst
+        = node->solution->relocation[node->solution->n_relocation - 1].dst;
+    }
+
+    for(i = 0; i < problem->n_stack; ++i) {
+      if(node->state->stack[i].n_tier == 0) {
+        continue;
+      }
+
+      for(j = 0; j < problem->n_stack; ++j) {
+        if(j == i || node->state->stack[j].n_tier == problem->s_height
+           || (i == last_dst && j == last_src)) {
+          continue;
+        }
+
+        copy_state(problem, cstate, node->state);
+        block = cstate->block[i][cstate->stack[i].n_tier - 1];
+        update_state(problem, cstate, i, j);
+
+        if(cstate->n_misoverlay == 0) {
+          /* solved */
+          if(beam->level < worker->solution->n_relocation) {
+            copy_solution(worker->solution, node->solution);
+            add_relocation(worker->solution, i, j, &block);
+          }
+          continue;
+        }
+
+        clb_state = initialize_lb_state(problem, cstate, clb_state);
+        lower_bound(worker->lb_work, problem, cstate, clb_state,
+                    beam->upper_bound - beam->level - 1, False);
+
+        if(beam->level + clb_state->lb >= beam->upper_bound) {
+          continue;
+        }
+
+        if(clb_state->n_dirty_stack + clb_state->n_full_clean_stack
+           < problem->n_stack) {
+          /* upper bound computation */
+          copy_solution(csolution, node->solution);
+          add_relocation(csolution, i, j, &block);
+          if(heuristics(worker->heuristics_work, problem, cstate, csolution,
+                        min(beam->upper_bound,
+                            worker->solution->n_relocation))) {
+            copy_solution(worker->solution, csolution);
+          }
+        }
+
+        child[beam->n_child[k]].parent = k;
+        child[beam->n_child[k]].src = i;
+        child[beam->n_child[k]].dst = j;
+        child[beam->n_child[k]].lb = clb_state->lb;
+        child[beam->n_child[k]++].n_misoverlay = cstate->n_misoverlay;
+      }
+    }
+  }
+
+  free_lb_state(clb_state);
+  free_solution(csolution);
+  free_state(cstate);
+
+  return(NULL);
+}
+
+int beam_child_comp(const void *a, const void *b)
+{
+  beam_child_t *x = (beam_child_t *) a;
+  beam_child_t *y = (beam_child_t *) b;
+
+  if(x->lb > y->lb) {
+    return(1);
+  } else if(x->lb < y->lb) {
+    return(-1);
+  } else if(x->n_misoverlay > y->n_misoverlay) {
+    return(1);
+  } else if(x->n_misoverlay < y->n_misoverlay) {
+    return(-1);
+  } else if(x->parent > y->parent) {
+    return(1);
+  } else if(x->parent < y->parent) {
+    return(-1);
+  } else if(x->src > y->src) {
+    return(1);
+  } else if(x->src < y->src) {
+    return(-1);
+  } else if(x->dst > y->dst) {
+    return(1);
+  } else if(x->dst < y->dst) {
+    return(-1);
+  }
+
+  return(0);
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "define.h"
+#include "bundle.h"
+#include "input.h"
+#include "problem.h"
+
+#define ALIGN8(n) (((n) + 7) & ~((ulint) 7))
+
+static ulint position_offset(int, int);
+static ulint instance_size(int, int, int);
+
+/*
+ * write the instances in the files input[0..n-1] (read by read_file()
+ * with n_stack, s_height and n_empty_tier) to the bundle filename.
+ * the files that fail to be read are skipped.  returns the number of
+ * the instances written, or -1 on failure.
+ *
+ */
+int write_bundle(char *filename, int n, char **input, int n_stack,
+                 int s_height, int n_empty_tier)
+{
+  int i, k;
+  char tmpname[MAXBUFLEN + 16];
+  char zero[8] = {0};
+  ulint offset;
+  uchar error = False;
+  FILE *fp;
+  problem_t *problem;
+  bundle_header_t header;
+  bundle_entry_t *entry
+    = (bundle_entry_t *) calloc((size_t) max(n, 1), sizeof(bundle_entry_t));
+  /* source[k]: the file of the k-th instance */
+  int *source = (int *) malloc((size_t) max(n, 1)*sizeof(int));
+
+  /* write to a temporary file first, so readers never see a partial one */
+  snprintf(tmpname, MAXBUFLEN + 16, "%s.%d", filename, (int) getpid());
+  if((fp = fopen(tmpname, "wb")) == NULL) {
+    fprintf(stderr, "Failed to open file: %s\n", tmpname);
+    free(source);
+    free(entry);
+    return(-1);
+  }
+
+  memset((void *) &header, 0, sizeof(bundle_header_t));
+  memcpy((void *) header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+
+  /* the header and the index are written at the end */
+  offset = ALIGN8(sizeof(bundle_header_t) + (ulint) n*sizeof(bundle_entry_t));
+  fseek(fp, (long) offset, SEEK_SET);
+
+  for(i = 0, k = 0; i < n; ++i) {
+    ulint size;
+
+    if((problem = read_file(input[i], n_stack, s_height, n_empty_tier))
+       == NULL) {
+      fprintf(stderr, "Skipped: %s\n", input[i]);
+      continue;
+    }
+
+    entry[k].offset = offset;
+    entry[k].n_block = problem->n_block;
+    entry[k].n_stack = problem->n_stack;
+    entry[k].s_height = problem->s_height;
+    entry[k].max_priority = problem->max_priority;
+    entry[k].duplicate = (int) problem->duplicate;
+    header.max_n_stack = max(header.max_n_stack, problem->n_stack);
+    source[k++] = i;
+
+    /* priority and n_tier are contiguous as in create_problem() */
+    size = (ulint) (problem->n_block + problem->n_stack)*sizeof(int);
+    fwrite((void *) problem->priority, 1, (size_t) size, fp);
+    fwrite((void *) zero, 1,
+           (size_t) (position_offset(problem->n_block, problem->n_stack)
+                     - size), fp);
+    fwrite((void *) problem->position, sizeof(coordinate_t),
+           (size_t) problem->n_block, fp);
+    fwrite((void *) problem->block[0], sizeof(block_t),
+           (size_t) problem->n_stack*problem->s_height, fp);
+    offset += instance_size(problem->n_block, problem->n_stack,
+                            problem->s_height);
+    fwrite((void *) zero, 1, (size_t) (offset - (ulint) ftell(fp)), fp);
+
+    free_problem(problem);
+  }
+
+  for(i = 0; i < k; ++i) {
+    entry[i].name = offset;
+    offset += (ulint) strlen(input[source[i]]) + 1;
+    fwrite((void *) input[source[i]], 1, strlen(input[source[i]]) + 1, fp);
+  }
+
+  header.n_instance = k;
+  header.size = offset;
+  fseek(fp, 0L, SEEK_SET);
+  if(fwrite((void *) &header, sizeof(bundle_header_t), 1, fp) != 1
+     || fwrite((void *) entry, sizeof(bundle_entry_t), (size_t) k, fp)
+     != (size_t) k) {
+    error = True;
+  }
+  if(fclose(fp) != 0 || error == True) {
+    fprintf(stderr, "Failed to write file: %s\n", tmpname);
+    remove(tmpname);
+    k = -1;
+  } else {
+    rename(tmpname, filename);
+  }
+
+  free(source);
+  free(entry);
+
+  return(k);
+}
+
+/*
+ * True if file filename begins with the magic of a bundle
+ *
+ */
+uchar is_bundle(char *filename)
+{
+  char magic[sizeof(BUNDLE_MAGIC)];
+  FILE *fp;
+  uchar ret = False;
+
+  if((fp = fopen(filename, "rb")) != NULL) {
+    if(fread(magic, sizeof(BUNDLE_MAGIC), 1, fp) == 1
+       && memcmp(magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) == 0) {
+      ret = True;
+    }
+    fclose(fp);
+  }
+
+  return(ret);
+}
+
+/*
+ * map the bundle filename into memory
+ * returns NULL if filename is not a valid bundle.
+ *
+ */
+bundle_t *open_bundle(char *filename)
+{
+  int i, fd;
+  struct stat st;
+  char *map;
+  bundle_header_t *header;
+  bundle_entry_t *entry;
+  bundle_t *bundle;
+
+  if((fd = open(filename, O_RDONLY)) < 0) {
+    return(NULL);
+  }
+  if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+     || (size_t) st.st_size < sizeof(bundle_header_t)) {
+    fprintf(stderr, "Broken bundle: %s\n", filename);
+    close(fd);
+    return(NULL);
+  }
+  map = (char *) mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd,
+                      0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    return(NULL);
+  }
+
+  header = (bundle_header_t *) map;
+  entry = (bundle_entry_t *) (map + sizeof(bundle_header_t));
+  if(memcmp(header->magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0
+     || header->size != (ulint) st.st_size || header->n_instance < 0
+     || sizeof(bundle_header_t)
+     + (ulint) header->n_instance*sizeof(bundle_entry_t) > header->size) {
+    fprintf(stderr, "Broken bundle: %s\n", filename);
+    munmap((void *) map, (size_t) st.st_size);
+    return(NULL);
+  }
+
+  for(i = 0; i < header->n_instance; ++i) {
+    if(entry[i].n_stack <= 0 || entry[i].n_stack > header->max_n_stack
+       || entry[i].s_height <= 0 || entry[i].n_block <= 0
+       || entry[i].n_block > entry[i].n_stack*entry[i].s_height
+       || entry[i].max_priority < 0
+       || entry[i].max_priority >= entry[i].n_block
+       || entry[i].offset%8 != 0 || entry[i].offset > header->size
+       || instance_size(entry[i].n_block, entry[i].n_stack,
+                        entry[i].s_height)
+       > header->size - entry[i].offset
+       || entry[i].name >= header->size
+       || memchr((void *) (map + entry[i].name), '\0',
+                 (size_t) (header->size - entry[i].name)) == NULL) {
+      fprintf(stderr, "Broken bundle: %s\n", filename);
+      munmap((void *) map, (size_t) st.st_size);
+      return(NULL);
+    }
+  }
+
+  bundle = (bundle_t *) malloc(sizeof(bundle_t));
+  bundle->n_instance = header->n_instance;
+  bundle->max_n_stack = header->max_n_stack;
+  bundle->entry = entry;
+  bundle->map = map;
+  bundle->map_size = (size_t) st.st_size;
+
+  return(bundle);
+}
+
+void close_bundle(bundle_t *bundle)
+{
+  if(bundle != NULL) {
+    munmap((void *) bundle->map, bundle->map_size);
+    free(bundle);
+  }
+}
+
+char *bundle_name(bundle_t *bundle, int k)
+{
+  return(bundle->map + bundle->entry[k].name);
+}
+
+/*
+ * problem_t whose arrays are those of an instance in bundle
+ * (set by problem_view(), read only)
+ *
+ */
+problem_t *create_problem_view(bundle_t *bundle)
+{
+  problem_t *problem = (problem_t *) calloc(1, sizeof(problem_t));
+
+  problem->block
+    = (block_t **) malloc((size_t) max(bundle->max_n_stack, 1)
+                          *sizeof(block_t *));
+
+  return(problem);
+}
+
+/*
+ * point problem created by create_problem_view() to the k-th instance
+ * of bundle.  no memory is allocated.
+ *
+ */
+problem_t *problem_view(bundle_t *bundle, problem_t *problem, int k)
+{
+  int s;
+  bundle_entry_t *entry = &(bundle->entry[k]);
+  char *data = bundle->map + entry->offset;
+
+  problem->duplicate = (uchar) entry->duplicate;
+  problem->n_block = entry->n_block;
+  problem->n_stack = entry->n_stack;
+  problem->s_height = entry->s_height;
+  problem->max_priority = entry->max_priority;
+  problem->priority = (int *) data;
+  problem->n_tier = problem->priority + entry->n_block;
+  problem->position
+    = (coordinate_t *) (data + position_offset(entry->n_block,
+                                               entry->n_stack));
+  problem->block[0] = (block_t *) (problem->position + entry->n_block);
+  for(s = 1; s < entry->n_stack; ++s) {
+    problem->block[s] = problem->block[s - 1] + entry->s_height;
+  }
+  problem->stime = problem->time = 0.0;
+
+  return(problem);
+}
+
+void free_problem_view(problem_t *problem)
+{
+  if(problem != NULL) {
+    free(problem->block);
+    free(problem);
+  }
+}
+
+ulint position_offset(int n_block, int n_stack)
+{
+  return(ALIGN8((ulint) (n_block + n_stack)*sizeof(int)));
+}
+
+ulint instance_size(int n_block, int n_stack, int s_height)
+{
+  return(ALIGN8(position_offset(n_block, n_stack)
+                + (ulint) n_block*sizeof(coordinate_t)
+                + (ulint) n_stack*s_height*sizeof(block_t)));
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#ifndef BUNDLE_H
+#define BUNDLE_H
+#include <stdio.h>
+#include "define.h"
+#include "problem.h"
+
+#define BUNDLE_MAGIC "PMPBDL1"
+
+/*
+ * file layout (native byte order)
+ *   bundle_header_t
+ *   bundle_entry_t[n_instance]
+ *   for each instance (8-byte aligned):
+ *     int priority[n_block], n_tier[n_stack]
+ *     coordinate_t position[n_block] (8-byte aligned)
+ *     block_t block[n_stack*s_height]
+ *   names of the instances ('\0' terminated)
+ * the arrays are those of problem_t after read_file().
+ *
+ */
+typedef struct {
+  char magic[8];
+  int n_instance;
+  int max_n_stack;
+  ulint size;
+} bundle_header_t;
+
+typedef struct {
+  /* offset of the data of the instance from the top of the file */
+  ulint offset;
+  /* offset of the name from the top of the file */
+  ulint name;
+  int n_block;
+  int n_stack;
+  int s_height;
+  int max_priority;
+  int duplicate;
+  int reserved;
+} bundle_entry_t;
+
+typedef struct {
+  int n_instance;
+  int max_n_stack;
+  bundle_entry_t *entry;
+  char *map;
+  size_t map_size;
+} bundle_t;
+
+int write_bundle(char *, int, char **, int, int, int);
+uchar is_bundle(char *);
+bundle_t *open_bundle(char *);
+void close_bundle(bundle_t *);
+char *bundle_name(bundle_t *, int);
+problem_t *create_problem_view(bundle_t *);
+problem_t *problem_view(bundle_t *, problem_t *, int);
+void free_problem_view(problem_t *);
+
+#endif /* !BUNDLE_H */
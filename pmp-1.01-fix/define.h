@@ -53,7 +53,15 @@
 #define MAX_N_RELOCATION (200)
 #endif /* !MAXBUFLEN */
 
-enum { False = 0, True = 1, TimeLimit = 2 };
+#ifndef THREAD_LOCAL
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else /* !_MSC_VER */
+#define THREAD_LOCAL __thread
+#endif /* !_MSC_VER */
+#endif /* !THREAD_LOCAL */
+
+enum { False = 0, True = 1, TimeLimit = 2, Interrupted = 3 };
 
 typedef unsigned short ushort;
 typedef unsigned char uchar;
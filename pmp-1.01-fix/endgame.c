@@ -0,0 +1,429 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "define.h"
+#include "endgame.h"
+#include "problem.h"
+#include "solution.h"
+
+/* the transposition table has 1<<ENDGAME_TABLE_BITS entries */
+#define ENDGAME_TABLE_BITS (15)
+/* maximum number of nodes searched by one call */
+#define ENDGAME_MAX_NODE (1000)
+/* maximum number of relocations of clean blocks searched */
+#define ENDGAME_MAX_SLACK (2)
+
+/*
+ * exact endgame solver
+ * when only a few blocks are misoverlaid, the remaining problem is
+ * solved exactly by iterative deepening over a plain copy of the
+ * stacks, without dominance rules and lower bound states.  the lower
+ * bounds proven by the failed iterations are kept in a transposition
+ * table.  the key of a state is the sum of hash values of its stacks,
+ * so that it does not depend on the order of the stacks.
+ *
+ */
+typedef struct {
+  ulint key1;
+  ulint key2;
+  int lb;
+  uchar exact;
+} endgame_entry_t;
+
+struct endgame {
+  int n_misoverlay;
+  int *n_tier;
+  int *n_clean;
+  block_t **block;
+  ulint key1, key2;
+  ulint *hash1, *hash2;
+  /* prefix[s][k]: hash value of the lowest k blocks in stack s */
+  ulint **prefix;
+  endgame_entry_t *table;
+  ulint n_node;
+  /* relocations are recorded in path when record is True */
+  uchar record;
+  int path_length;
+  relocation_t *path;
+};
+
+static void load(endgame_t *, problem_t *, state_t *);
+static void relocate(endgame_t *, int, int);
+static void hash_stack(endgame_t *, int);
+static ulint mix(ulint);
+static int simple_lb(endgame_t *, problem_t *);
+static uchar search(endgame_t *, problem_t *, int, int, int, int);
+static uchar put_back_cut(endgame_t *, problem_t *, int, int, int);
+static endgame_entry_t *probe(endgame_t *);
+static void store(endgame_t *, int, uchar);
+
+endgame_t *create_endgame(problem_t *problem)
+{
+  int i;
+  endgame_t *eg = (endgame_t *) malloc(sizeof(endgame_t));
+
+  eg->n_tier = (int *) malloc((size_t) 2*problem->n_stack*sizeof(int));
+  eg->n_clean = eg->n_tier + problem->n_stack;
+  eg->hash1 = (ulint *) malloc((size_t) 2*problem->n_stack*sizeof(ulint));
+  eg->hash2 = eg->hash1 + problem->n_stack;
+  eg->block
+    = (block_t **) malloc((size_t) problem->n_stack*sizeof(block_t *));
+  eg->block[0] = (block_t *) malloc((size_t) problem->n_stack
+                                    *problem->s_height*sizeof(block_t));
+  eg->prefix = (ulint **) malloc((size_t) problem->n_stack*sizeof(ulint *));
+  eg->prefix[0] = (ulint *) malloc((size_t) problem->n_stack
+                                   *(problem->s_height + 1)*sizeof(ulint));
+  for(i = 1; i < problem->n_stack; ++i) {
+    eg->block[i] = eg->block[i - 1] + problem->s_height;
+    eg->prefix[i] = eg->prefix[i - 1] + problem->s_height + 1;
+  }
+  eg->path = (relocation_t *) malloc((size_t) (MAX_N_RELOCATION + 1)
+                                     *sizeof(relocation_t));
+  eg->table = (endgame_entry_t *) calloc((size_t) 1<<ENDGAME_TABLE_BITS,
+                                         sizeof(endgame_entry_t));
+  eg->record = False;
+
+  return(eg);
+}
+
+void free_endgame(endgame_t *eg)
+{
+  if(eg != NULL) {
+    free(eg->table);
+    free(eg->path);
+    free(eg->prefix[0]);
+    free(eg->prefix);
+    free(eg->block[0]);
+    free(eg->block);
+    free(eg->hash1);
+    free(eg->n_tier);
+    free(eg);
+  }
+}
+
+/* the exact number of the remaining relocations if it is at most */
+/* budget, budget + 1 if it is proven to exceed budget, and -1 if */
+/* the search is given up.  lb is a lower bound of the state */
+int endgame(endgame_t *eg, problem_t *problem, state_t *state, int lb,
+            int budget)
+{
+  int bound;
+  uchar ret;
+  endgame_entry_t *entry;
+
+  load(eg, problem, state);
+
+  bound = max(lb, simple_lb(eg, problem));
+  if((entry = probe(eg)) != NULL) {
+    if(entry->exact == True) {
+      return((entry->lb > budget)?(budget + 1):entry->lb);
+    }
+    bound = max(bound, entry->lb);
+  }
+
+  eg->n_node = 0;
+  for(; bound <= budget; ++bound) {
+    if(bound > eg->n_misoverlay + ENDGAME_MAX_SLACK) {
+      return(-1);
+    }
+    ret = search(eg, problem, bound, 0, -1, -1);
+    if(ret == True) {
+      return(bound);
+    } else if(ret == Interrupted) {
+      return(-1);
+    }
+  }
+
+  return(budget + 1);
+}
+
+/* append an optimal sequence of relocations whose length is cost */
+/* computed by endgame() */
+void endgame_solution(endgame_t *eg, problem_t *problem, state_t *state,
+                      int cost, solution_t *solution)
+{
+  int i;
+  relocation_t *path = eg->path;
+
+  load(eg, problem, state);
+
+  eg->record = True;
+  eg->path_length = 0;
+  search(eg, problem, cost, 0, -1, -1);
+  eg->record = False;
+
+  for(i = 0; i < eg->path_length; ++i) {
+    add_relocation(solution, path[i].src, path[i].dst, &(path[i].block));
+  }
+}
+
+void load(endgame_t *eg, problem_t *problem, state_t *state)
+{
+  int i, k;
+  int *n_tier = eg->n_tier, *n_clean = eg->n_clean;
+  block_t **block = eg->block;
+  ulint **prefix = eg->prefix;
+
+  eg->n_misoverlay = 0;
+  eg->key1 = eg->key2 = 0;
+  for(i = 0; i < problem->n_stack; ++i) {
+    n_tier[i] = state->stack[i].n_tier;
+    prefix[i][0] = 1;
+    for(k = 0; k < n_tier[i]; ++k) {
+      block[i][k] = state->block[i][k];
+      prefix[i][k + 1] = prefix[i][k]*0x100000001b3ULL
+        + (ulint) block[i][k].priority + 1;
+    }
+
+    for(k = 1; k < n_tier[i]
+          && block[i][k].priority <= block[i][k - 1].priority; ++k);
+    n_clean[i] = min(k, n_tier[i]);
+    eg->n_misoverlay += n_tier[i] - n_clean[i];
+
+    eg->hash1[i] = eg->hash2[i] = 0;
+    hash_stack(eg, i);
+  }
+}
+
+void relocate(endgame_t *eg, int src, int dst)
+{
+  int *n_tier = eg->n_tier, *n_clean = eg->n_clean;
+  block_t **block = eg->block;
+  ulint **prefix = eg->prefix;
+  block_t reloc_block = block[src][--n_tier[src]];
+
+  if(n_clean[src] > n_tier[src]) {
+    /* clean block */
+    --n_clean[src];
+  } else {
+    --eg->n_misoverlay;
+  }
+
+  if(n_clean[dst] == n_tier[dst]
+     && (n_tier[dst] == 0
+         || block[dst][n_tier[dst] - 1].priority >= reloc_block.priority)) {
+    ++n_clean[dst];
+  } else {
+    ++eg->n_misoverlay;
+  }
+  prefix[dst][n_tier[dst] + 1] = prefix[dst][n_tier[dst]]*0x100000001b3ULL
+    + (ulint) reloc_block.priority + 1;
+  block[dst][n_tier[dst]++] = reloc_block;
+
+  hash_stack(eg, src);
+  hash_stack(eg, dst);
+}
+
+void hash_stack(endgame_t *eg, int s)
+{
+  ulint h = eg->prefix[s][eg->n_tier[s]];
+
+  eg->key1 -= eg->hash1[s];
+  eg->key2 -= eg->hash2[s];
+  eg->hash1[s] = mix(h);
+  eg->hash2[s] = mix(h ^ 0x9e3779b97f4a7c15ULL);
+  eg->key1 += eg->hash1[s];
+  eg->key2 += eg->hash2[s];
+}
+
+ulint mix(ulint z)
+{
+  z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+  return(z ^ (z >> 31));
+}
+
+/* every misoverlaid block is relocated at least once, and one more */
+/* relocation is necessary if no clean stack has an empty slot */
+int simple_lb(endgame_t *eg, problem_t *problem)
+{
+  int i;
+
+  if(eg->n_misoverlay == 0) {
+    return(0);
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    if(eg->n_clean[i] == eg->n_tier[i]
+       && eg->n_tier[i] < problem->s_height) {
+      return(eg->n_misoverlay);
+    }
+  }
+
+  return(eg->n_misoverlay + 1);
+}
+
+uchar search(endgame_t *eg, problem_t *problem, int bound, int depth,
+             int last_src, int last_dst)
+{
+  int i, j, lb, n_left;
+  int *n_tier = eg->n_tier, *n_clean = eg->n_clean;
+  block_t **block = eg->block;
+  uchar ret, empty_stack, misoverlaid;
+  endgame_entry_t *entry;
+
+  if(eg->n_misoverlay == 0) {
+    eg->path_length = depth;
+    return(True);
+  }
+
+  if(simple_lb(eg, problem) > bound) {
+    return(False);
+  }
+
+  if((entry = probe(eg)) != NULL) {
+    if(entry->lb > bound) {
+      return(False);
+    } else if(entry->exact == True && eg->record == False) {
+      return(True);
+    }
+  }
+
+  if(eg->record == False && ++eg->n_node > ENDGAME_MAX_NODE) {
+    return(Interrupted);
+  }
+
+  /* relocate the misoverlaid blocks first */
+  for(misoverlaid = True; ; misoverlaid = False) {
+    for(i = 0; i < problem->n_stack; ++i) {
+      if(n_tier[i] == 0 || (n_clean[i] < n_tier[i]) != misoverlaid) {
+        continue;
+      }
+
+      /* misoverlaid blocks left after the relocation from stack i */
+      n_left = eg->n_misoverlay - ((misoverlaid == True)?1:0);
+
+      empty_stack = False;
+      for(j = 0; j < problem->n_stack; ++j) {
+        if(j == i || n_tier[j] == problem->s_height) {
+          continue;
+        }
+        if(n_tier[j] == 0) {
+          if(empty_stack == True) {
+            /* second empty stack */
+            continue;
+          }
+          empty_stack = True;
+        }
+        if(i == last_dst && j == last_src) {
+          /* the block is put back */
+          continue;
+        }
+        if(n_left >= bound
+           && (n_clean[j] < n_tier[j]
+               || (n_tier[j] > 0 && block[j][n_tier[j] - 1].priority
+                   < block[i][n_tier[i] - 1].priority))) {
+          /* the block is misoverlaid in stack j */
+          continue;
+        }
+
+        relocate(eg, i, j);
+        if(eg->record == True) {
+          eg->path[depth].src = i;
+          eg->path[depth].dst = j;
+          eg->path[depth].block = block[j][n_tier[j] - 1];
+        }
+        ret = search(eg, problem, bound - 1, depth + 1, i, j);
+        relocate(eg, j, i);
+
+        if(ret == True) {
+          lb = simple_lb(eg, problem);
+          if((entry = probe(eg)) != NULL) {
+            lb = max(lb, entry->lb);
+          }
+          if(lb == bound) {
+            store(eg, bound, True);
+          }
+          return(True);
+        } else if(ret == Interrupted) {
+          return(Interrupted);
+        }
+      }
+    }
+
+    if(misoverlaid == False) {
+      break;
+    }
+  }
+
+  if(last_src < 0 || put_back_cut(eg, problem, bound, last_src, last_dst)) {
+    /* the failure does not depend on the relocation skipped above, */
+    /* which may be on the only optimal path from another parent */
+    store(eg, bound + 1, False);
+  }
+
+  return(False);
+}
+
+/* True if the block relocated from src to dst and put back is cut */
+/* off by bound (the state is that of the parent node) */
+uchar put_back_cut(endgame_t *eg, problem_t *problem, int bound, int src,
+                   int dst)
+{
+  uchar cut;
+  endgame_entry_t *entry;
+
+  relocate(eg, dst, src);
+  cut = (simple_lb(eg, problem) > bound - 1
+         || ((entry = probe(eg)) != NULL && entry->lb > bound - 1))
+    ?True:False;
+  relocate(eg, src, dst);
+
+  return(cut);
+}
+
+endgame_entry_t *probe(endgame_t *eg)
+{
+  endgame_entry_t *entry
+    = &(eg->table[eg->key1 >> (64 - ENDGAME_TABLE_BITS)]);
+
+  return((entry->key1 == eg->key1 && entry->key2 == eg->key2)?entry:NULL);
+}
+
+void store(endgame_t *eg, int lb, uchar exact)
+{
+  endgame_entry_t *entry
+    = &(eg->table[eg->key1 >> (64 - ENDGAME_TABLE_BITS)]);
+
+  if(entry->key1 != eg->key1 || entry->key2 != eg->key2) {
+    entry->key1 = eg->key1;
+    entry->key2 = eg->key2;
+    entry->lb = lb;
+    entry->exact = exact;
+  } else if(lb > entry->lb || exact == True) {
+    entry->lb = lb;
+    entry->exact = exact;
+  }
+}
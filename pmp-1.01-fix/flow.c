@@ -0,0 +1,303 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "define.h"
+#include "flow.h"
+#include "problem.h"
+#include "solution.h"
+
+/* upper limit of the scaling factor of the arc costs */
+#define FLOW_MAX_SCALE (1<<16)
+
+/*
+ * assignment relaxation
+ * every misoverlaid block is assigned to the stack where it is finally
+ * placed.  a block of priority p can be placed in stack d after the
+ * removal of k = removal_for_supply[d][p] clean blocks, which provides
+ * s_height - n_clean + k slots.  the removal cost is shared by the
+ * blocks placed there, so that the cost of the assignment is
+ * k/(s_height - n_clean + k).  a block finally placed in its current
+ * stack is relocated at least twice, and the cost 1 is added.  the
+ * transportation problem from (stack, priority) classes of misoverlaid
+ * blocks to stacks is solved by the successive shortest path method.
+ *
+ */
+typedef struct {
+  int to;
+  int cap;
+  int cost;
+} arc_t;
+
+typedef struct {
+  int stack;
+  int priority;
+  int n_block;
+} class_t;
+
+/* working area of the assignment relaxation */
+struct flow {
+  int n_node, n_arc;
+  int scale;
+  arc_t *arc;
+  /* first[u]: the first arc from node u, next[e]: the next arc of arc e */
+  int *first, *next;
+  int *dist, *pred, *queue;
+  uchar *in_queue;
+  class_t *class;
+  /* class_cost[c*n_stack + d]: cost of assigning a block of class c */
+  /* to stack d */
+  int *class_cost, *residual;
+};
+
+static void add_arc(flow_t *, int, int, int, int);
+static int min_cost_flow(flow_t *, int, int);
+
+flow_t *create_flow(problem_t *problem)
+{
+  int i, a, b, t;
+  int max_n_node = problem->n_block + problem->n_stack + 2;
+  int max_n_arc = 2*(problem->n_block*(problem->n_stack + 1)
+                     + problem->n_stack);
+  flow_t *flow = (flow_t *) malloc(sizeof(flow_t));
+
+  /* least common multiple of 1, ..., s_height */
+  flow->scale = 1;
+  for(i = 2; i <= problem->s_height; ++i) {
+    for(a = flow->scale, b = i; b > 0; t = a%b, a = b, b = t);
+    if(flow->scale/a*i > FLOW_MAX_SCALE) {
+      /* costs are rounded down */
+      flow->scale = FLOW_MAX_SCALE;
+      break;
+    }
+    flow->scale = flow->scale/a*i;
+  }
+
+  flow->arc = (arc_t *) malloc((size_t) max_n_arc*sizeof(arc_t));
+  flow->next = (int *) malloc((size_t) (max_n_arc + 4*max_n_node)*sizeof(int));
+  flow->first = flow->next + max_n_arc;
+  flow->dist = flow->first + max_n_node;
+  flow->pred = flow->dist + max_n_node;
+  flow->queue = flow->pred + max_n_node;
+  flow->in_queue = (uchar *) malloc((size_t) max_n_node*sizeof(uchar));
+  flow->class = (class_t *) malloc((size_t) problem->n_block*sizeof(class_t));
+  flow->class_cost = (int *) malloc((size_t) (problem->n_block + 1)
+                                    *problem->n_stack*sizeof(int));
+  flow->residual = flow->class_cost + problem->n_block*problem->n_stack;
+
+  return(flow);
+}
+
+void free_flow(flow_t *flow)
+{
+  if(flow != NULL) {
+    free(flow->class_cost);
+    free(flow->class);
+    free(flow->in_queue);
+    free(flow->next);
+    free(flow->arc);
+    free(flow);
+  }
+}
+
+/* lower bound on the number of relocations by the assignment relaxation */
+/* if it can exceed clb_state->lb, and clb_state->lb otherwise */
+int flow_lower_bound(flow_t *flow, problem_t *problem, state_t *cstate,
+                     lb_state_t *clb_state)
+{
+  int i, j, k, c, d, n, f, n_removal, n_slot;
+  int n_class = 0, total_cost = 0;
+  int src = 0, sink = 1;
+  int scale = flow->scale;
+  int *cost, *class_cost = flow->class_cost, *residual = flow->residual;
+  class_t *class = flow->class;
+  stack_state_t *stack = cstate->stack;
+  block_t *block;
+
+  if(cstate->n_misoverlay == 0) {
+    return(0);
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    block = cstate->block[i];
+    for(j = stack[i].n_clean; j < stack[i].n_tier; j = k) {
+      /* misoverlaid blocks of the same priority in stack i */
+      for(k = j + 1; k < stack[i].n_tier
+            && block[k].priority == block[j].priority; ++k);
+
+      /* classes are sorted in the descending order of priorities */
+      for(c = n_class++;
+          c > 0 && class[c - 1].priority < block[j].priority; --c) {
+        class[c] = class[c - 1];
+      }
+      class[c].stack = i;
+      class[c].priority = block[j].priority;
+      class[c].n_block = k - j;
+    }
+  }
+
+  for(c = 0; c < n_class; ++c) {
+    cost = class_cost + c*problem->n_stack;
+    for(d = 0; d < problem->n_stack; ++d) {
+      n_removal = clb_state->removal_for_supply[d][class[c].priority];
+      n_slot = problem->s_height - stack[d].n_clean + n_removal;
+      cost[d] = (n_removal > 0)?(int) ((ulint) n_removal*scale/n_slot):0;
+      if(d == class[c].stack) {
+        cost[d] += scale;
+      }
+    }
+  }
+
+  /* upper bound of the minimum cost by greedy assignment */
+  for(d = 0; d < problem->n_stack; ++d) {
+    residual[d] = problem->s_height;
+  }
+  for(c = 0; c < n_class; ++c) {
+    cost = class_cost + c*problem->n_stack;
+    for(n = class[c].n_block; n > 0; n -= f) {
+      for(i = -1, d = 0; d < problem->n_stack; ++d) {
+        if(residual[d] > 0 && (i < 0 || cost[i] > cost[d])) {
+          i = d;
+        }
+      }
+      f = min(n, residual[i]);
+      residual[i] -= f;
+      total_cost += f*cost[i];
+    }
+  }
+
+  if(cstate->n_misoverlay + (total_cost + scale - 1)/scale <= clb_state->lb) {
+    /* the relaxation does not improve the lower bound */
+    return(clb_state->lb);
+  }
+
+  /* transportation problem */
+  flow->n_node = problem->n_stack + 2;
+  flow->n_arc = 0;
+  for(i = 0; i < flow->n_node + n_class; ++i) {
+    flow->first[i] = -1;
+  }
+
+  for(d = 0; d < problem->n_stack; ++d) {
+    add_arc(flow, 2 + d, sink, problem->s_height, 0);
+  }
+
+  for(c = 0; c < n_class; ++c, ++flow->n_node) {
+    cost = class_cost + c*problem->n_stack;
+    add_arc(flow, src, flow->n_node, class[c].n_block, 0);
+    for(d = 0; d < problem->n_stack; ++d) {
+      add_arc(flow, flow->n_node, 2 + d, class[c].n_block, cost[d]);
+    }
+  }
+
+  return(cstate->n_misoverlay
+         + (min_cost_flow(flow, src, sink) + scale - 1)/scale);
+}
+
+void add_arc(flow_t *flow, int u, int v, int cap, int cost)
+{
+  arc_t *arc = flow->arc;
+  int *first = flow->first, *next = flow->next;
+
+  arc[flow->n_arc].to = v;
+  arc[flow->n_arc].cap = cap;
+  arc[flow->n_arc].cost = cost;
+  next[flow->n_arc] = first[u];
+  first[u] = flow->n_arc++;
+
+  /* reverse arc */
+  arc[flow->n_arc].to = u;
+  arc[flow->n_arc].cap = 0;
+  arc[flow->n_arc].cost = - cost;
+  next[flow->n_arc] = first[v];
+  first[v] = flow->n_arc++;
+}
+
+/* successive shortest paths with a queue based Bellman-Ford method */
+int min_cost_flow(flow_t *flow, int src, int sink)
+{
+  int u, e, f, head, tail, total_cost = 0;
+  int n_node = flow->n_node;
+  int *first = flow->first, *next = flow->next;
+  int *dist = flow->dist, *pred = flow->pred, *queue = flow->queue;
+  uchar *in_queue = flow->in_queue;
+  arc_t *arc = flow->arc;
+
+  while(True) {
+    for(u = 0; u < n_node; ++u) {
+      dist[u] = INT_MAX;
+      in_queue[u] = False;
+    }
+    dist[src] = 0;
+    queue[0] = src;
+    in_queue[src] = True;
+    head = 0;
+    tail = 1;
+
+    while(head != tail) {
+      u = queue[head];
+      head = (head + 1)%n_node;
+      in_queue[u] = False;
+      for(e = first[u]; e >= 0; e = next[e]) {
+        if(arc[e].cap > 0 && dist[u] + arc[e].cost < dist[arc[e].to]) {
+          dist[arc[e].to] = dist[u] + arc[e].cost;
+          pred[arc[e].to] = e;
+          if(in_queue[arc[e].to] == False) {
+            queue[tail] = arc[e].to;
+            tail = (tail + 1)%n_node;
+            in_queue[arc[e].to] = True;
+          }
+        }
+      }
+    }
+
+    if(dist[sink] == INT_MAX) {
+      break;
+    }
+
+    /* augmentation along the shortest path */
+    f = INT_MAX;
+    for(u = sink; u != src; u = arc[pred[u]^1].to) {
+      f = min(f, arc[pred[u]].cap);
+    }
+    for(u = sink; u != src; u = arc[pred[u]^1].to) {
+      arc[pred[u]].cap -= f;
+      arc[pred[u]^1].cap += f;
+    }
+    total_cost += f*dist[sink];
+  }
+
+  return(total_cost);
+}
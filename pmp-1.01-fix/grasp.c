@@ -0,0 +1,155 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "define.h"
+#include "grasp.h"
+#include "heuristics.h"
+#include "print.h"
+#include "problem.h"
+#include "solution.h"
+#include "timer.h"
+
+/* maximum width of the restricted candidate list */
+#define GRASP_MAX_RCL (2)
+
+typedef struct {
+  problem_t *problem;
+  state_t *state;
+  solution_t *solution;
+  int lb;
+  double etime;
+  ulint n_iteration;
+  pthread_mutex_t mutex;
+} grasp_t;
+
+typedef struct {
+  grasp_t *grasp;
+  uint seed;
+} grasp_worker_t;
+
+static void *grasp_worker(void *);
+
+/*
+ * GRASP (randomized multi-start of the greedy heuristic)
+ * n_worker threads run until time_slice has elapsed or the incumbent
+ * reaches lb.  solution is updated when a better one is found.
+ *
+ */
+uchar grasp(problem_t *problem, state_t *state, solution_t *solution, int lb,
+            double time_slice, int n_worker)
+{
+  int i;
+  int n_relocation = solution->n_relocation;
+  grasp_t grasp;
+  grasp_worker_t *worker;
+  pthread_t *thread;
+
+  grasp.problem = problem;
+  grasp.state = state;
+  grasp.solution = solution;
+  grasp.lb = lb;
+  grasp.etime = get_time(problem) + time_slice;
+  grasp.n_iteration = 0;
+  pthread_mutex_init(&(grasp.mutex), NULL);
+
+  worker
+    = (grasp_worker_t *) malloc((size_t) n_worker*sizeof(grasp_worker_t));
+  thread = (pthread_t *) malloc((size_t) n_worker*sizeof(pthread_t));
+
+  for(i = 0; i < n_worker; ++i) {
+    worker[i].grasp = &grasp;
+    worker[i].seed = (uint) i + 1;
+    pthread_create(&(thread[i]), NULL, grasp_worker, (void *) &(worker[i]));
+  }
+  for(i = 0; i < n_worker; ++i) {
+    pthread_join(thread[i], NULL);
+  }
+
+  fprintf(stderr, "grasp iterations=%llu ", grasp.n_iteration);
+  print_time(problem);
+
+  free(thread);
+  free(worker);
+  pthread_mutex_destroy(&(grasp.mutex));
+
+  return((solution->n_relocation < n_relocation)?True:False);
+}
+
+void *grasp_worker(void *arg)
+{
+  grasp_worker_t *worker = (grasp_worker_t *) arg;
+  grasp_t *grasp = worker->grasp;
+  problem_t *problem = grasp->problem;
+  solution_t *csolution = create_solution();
+  heuristics_work_t *work = create_heuristics_work(problem);
+  ulint n_iteration = 0;
+  int ub;
+
+  pthread_mutex_lock(&(grasp->mutex));
+  ub = grasp->solution->n_relocation;
+  pthread_mutex_unlock(&(grasp->mutex));
+
+  while(ub > grasp->lb && get_time(problem) < grasp->etime) {
+    int rcl = (int) (rand_r(&(worker->seed)) % (GRASP_MAX_RCL + 1));
+
+    ++n_iteration;
+    csolution->n_relocation = 0;
+    if(randomized_heuristics(work, problem, grasp->state, csolution, ub,
+                             &(worker->seed), rcl)) {
+      pthread_mutex_lock(&(grasp->mutex));
+      if(csolution->n_relocation < grasp->solution->n_relocation) {
+        copy_solution(grasp->solution, csolution);
+        fprintf(stderr, "ub=%d grasp ", csolution->n_relocation);
+        print_time(problem);
+      }
+      pthread_mutex_unlock(&(grasp->mutex));
+    }
+
+    pthread_mutex_lock(&(grasp->mutex));
+    ub = grasp->solution->n_relocation;
+    pthread_mutex_unlock(&(grasp->mutex));
+  }
+
+  pthread_mutex_lock(&(grasp->mutex));
+  grasp->n_iteration += n_iteration;
+  pthread_mutex_unlock(&(grasp->mutex));
+
+  free_heuristics_work(work);
+  free_solution(csolution);
+
+  return(NULL);
+}
@@ -40,38 +40,75 @@
 #include "problem.h"
 #include "solution.h"
 
-uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
-                 int upper_bound)
+/* working area of the heuristics */
+struct heuristics_work {
+  state_t *cstate;
+  int *clean_stack, *dirty_stack;
+};
+
+static uchar heuristics_sub(heuristics_work_t *, problem_t *, state_t *,
+                            solution_t *, int, uint *, int);
+static int bg_destination(stack_state_t *, int *, int, int);
+static int gg_increase(problem_t *, state_t *, int *, int, int, int, int *,
+                       int *);
+
+heuristics_work_t *create_heuristics_work(problem_t *problem)
+{
+  heuristics_work_t *work
+    = (heuristics_work_t *) malloc(sizeof(heuristics_work_t));
+
+  work->cstate = create_state(problem);
+  work->clean_stack = (int *) malloc((size_t) 2*problem->n_stack*sizeof(int));
+  work->dirty_stack = work->clean_stack + problem->n_stack;
+
+  return(work);
+}
+
+void free_heuristics_work(heuristics_work_t *work)
+{
+  if(work != NULL) {
+    free_state(work->cstate);
+    free(work->clean_stack);
+    free(work);
+  }
+}
+
+uchar heuristics(heuristics_work_t *work, problem_t *problem, state_t *state,
+                 solution_t *solution, int upper_bound)
+{
+  return(heuristics_sub(work, problem, state, solution, upper_bound, NULL,
+                        0));
+}
+
+/*
+ * randomized variant for GRASP
+ * each relocation is chosen at random among the candidates whose
+ * evaluation is within rcl of the best one (rcl=0: random tie-breaking)
+ */
+uchar randomized_heuristics(heuristics_work_t *work, problem_t *problem,
+                            state_t *state, solution_t *solution,
+                            int upper_bound, uint *seed, int rcl)
+{
+  return(heuristics_sub(work, problem, state, solution, upper_bound, seed,
+                        rcl));
+}
+
+uchar heuristics_sub(heuristics_work_t *work, problem_t *problem,
+                     state_t *state, solution_t *solution, int upper_bound,
+                     uint *seed, int rcl)
 {
   int i, j;
   block_t block;
   int n_clean_stack = 0, n_dirty_stack = 0;
   stack_state_t *stack;
   solution_t *csolution = solution;
-  static state_t *cstate = NULL;
-  static int *clean_stack = NULL, *dirty_stack = NULL;
-
-  if(problem == NULL) {
-    if(cstate != NULL) {
-      free_state(cstate);
-      cstate = NULL;
-    }
-    if(clean_stack != NULL) {
-      free(clean_stack);
-      clean_stack = NULL;
-    }
-    return(False);
-  }
+  state_t *cstate = work->cstate;
+  int *clean_stack = work->clean_stack, *dirty_stack = work->dirty_stack;
 
 #if 0
   printf("heuristics\n");
 #endif
 
-  if(clean_stack == NULL) {
-    clean_stack = (int *) malloc((size_t) 2*problem->n_stack*sizeof(int));
-    dirty_stack = clean_stack + problem->n_stack;
-  }
-
   if(csolution == NULL) {
     csolution = create_solution();
   }
@@ -98,11 +135,7 @@ uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
     return(False);
   }
 
-  if(cstate == NULL) {
-    cstate = duplicate_state(problem, state);
-  } else {
-    copy_state(problem, cstate, state);
-  }
+  copy_state(problem, cstate, state);
 
   stack = cstate->stack;
   while(csolution->n_relocation < upper_bound) {
@@ -123,11 +156,7 @@ uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
       }
 
       /* destionation stack has the maximum priority among candidates */
-      for(j = n_clean_stack - 1; j >= 0; --j) {
-        if(stack[clean_stack[j]].clean_priority >= priority) {
-          break;
-        }
-      }
+      j = bg_destination(stack, clean_stack, n_clean_stack, priority);
 
       /* decrease of destination stack priority */
       decrease = stack[clean_stack[j]].clean_priority - priority;
@@ -165,6 +194,40 @@ uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
 #endif
     }
 
+    if(dst_index >= 0 && seed != NULL) {
+      /* restricted candidate list */
+      int n_candidate = 0, r;
+
+      for(i = 0; i < n_dirty_stack; ++i) {
+        priority
+          = cstate->block[dirty_stack[i]][stack[dirty_stack[i]].n_tier - 1]
+          .priority;
+        if(stack[clean_stack[0]].clean_priority >= priority) {
+          j = bg_destination(stack, clean_stack, n_clean_stack, priority);
+          if(stack[clean_stack[j]].clean_priority - priority
+             <= min_decrease + rcl) {
+            ++n_candidate;
+          }
+        }
+      }
+
+      r = (int) (rand_r(seed) % (uint) n_candidate);
+      for(i = 0; i < n_dirty_stack; ++i) {
+        priority
+          = cstate->block[dirty_stack[i]][stack[dirty_stack[i]].n_tier - 1]
+          .priority;
+        if(stack[clean_stack[0]].clean_priority >= priority) {
+          j = bg_destination(stack, clean_stack, n_clean_stack, priority);
+          if(stack[clean_stack[j]].clean_priority - priority
+             <= min_decrease + rcl && r-- == 0) {
+            src_index = i;
+            dst_index = j;
+            break;
+          }
+        }
+      }
+    }
+
     if(dst_index >= 0) {
       src_stack = dirty_stack[src_index];
     } else {
@@ -179,38 +242,8 @@ uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
       }
 
       for(i = 0; i < problem->n_stack; ++i) {
-        if(i == last_dst || stack[i].n_clean < stack[i].n_tier
-           || stack[i].clean_priority > stack[clean_stack[0]].clean_priority) {
-          continue;
-        }
-
-        if(stack[i].n_tier == 1) {
-          priority = problem->max_priority;
-        } else {
-          priority = cstate->block[i][stack[i].n_tier - 2].priority;
-        }
-
-        /* increase of source stack priority */
-        increase = priority - stack[i].clean_priority;
-
-        if(increase == 0) {
-          continue;
-        }
-
-        /* minimize decrease of destination stack priority */
-        for(j = n_clean_stack - 1; j >= 0; --j) {
-          if(clean_stack[j] != i
-             && stack[clean_stack[j]].clean_priority
-             >= stack[i].clean_priority) {
-            break;
-          }
-        }
-        if(j < 0) {
-          continue;
-        }
-
-        increase
-          -= stack[clean_stack[j]].clean_priority - stack[i].clean_priority;
+        increase = gg_increase(problem, cstate, clean_stack, n_clean_stack,
+                               i, last_dst, &priority, &j);
 
         /* heuristic rule for next relocation */
         if(increase > max_increase
@@ -228,6 +261,30 @@ uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
       if(dst_index < 0) {
         break;
       }
+
+      if(seed != NULL) {
+        /* restricted candidate list */
+        int n_candidate = 0, r;
+
+        for(i = 0; i < problem->n_stack; ++i) {
+          increase = gg_increase(problem, cstate, clean_stack, n_clean_stack,
+                                 i, last_dst, &priority, &j);
+          if(increase > 0 && increase >= max_increase - rcl) {
+            ++n_candidate;
+          }
+        }
+
+        r = (int) (rand_r(seed) % (uint) n_candidate);
+        for(i = 0; i < problem->n_stack; ++i) {
+          increase = gg_increase(problem, cstate, clean_stack, n_clean_stack,
+                                 i, last_dst, &priority, &j);
+          if(increase > 0 && increase >= max_increase - rcl && r-- == 0) {
+            src_stack = i;
+            dst_index = j;
+            break;
+          }
+        }
+      }
     }
 
     dst_stack = clean_stack[dst_index];
@@ -300,3 +357,62 @@ uchar heuristics(problem_t *problem, state_t *state, solution_t *solution,
   csolution->n_relocation = MAX_N_RELOCATION + 1;
   return(False);
 }
+
+/* clean stack receiving a BG relocation of the given priority */
+int bg_destination(stack_state_t *stack, int *clean_stack, int n_clean_stack,
+                   int priority)
+{
+  int j;
+
+  for(j = n_clean_stack - 1; j >= 0; --j) {
+    if(stack[clean_stack[j]].clean_priority >= priority) {
+      break;
+    }
+  }
+
+  return(j);
+}
+
+/* evaluation of a GG relocation from stack i (0: not applicable) */
+int gg_increase(problem_t *problem, state_t *cstate, int *clean_stack,
+                int n_clean_stack, int i, int last_dst, int *priority,
+                int *dst_index)
+{
+  int j;
+  int increase;
+  stack_state_t *stack = cstate->stack;
+
+  if(i == last_dst || stack[i].n_clean < stack[i].n_tier
+     || stack[i].clean_priority > stack[clean_stack[0]].clean_priority) {
+    return(0);
+  }
+
+  if(stack[i].n_tier == 1) {
+    *priority = problem->max_priority;
+  } else {
+    *priority = cstate->block[i][stack[i].n_tier - 2].priority;
+  }
+
+  /* increase of source stack priority */
+  increase = *priority - stack[i].clean_priority;
+
+  if(increase == 0) {
+    return(0);
+  }
+
+  /* minimize decrease of destination stack priority */
+  for(j = n_clean_stack - 1; j >= 0; --j) {
+    if(clean_stack[j] != i
+       && stack[clean_stack[j]].clean_priority >= stack[i].clean_priority) {
+      break;
+    }
+  }
+  if(j < 0) {
+    return(0);
+  }
+
+  *dst_index = j;
+
+  return(increase
+         - (stack[clean_stack[j]].clean_priority - stack[i].clean_priority));
+}
@@ -37,6 +37,14 @@
 #include "problem.h"
 #include "solution.h"
 
-uchar heuristics(problem_t *, state_t *, solution_t *, int);
+/* working area of the heuristics for a problem */
+typedef struct heuristics_work heuristics_work_t;
+
+heuristics_work_t *create_heuristics_work(problem_t *);
+void free_heuristics_work(heuristics_work_t *);
+uchar heuristics(heuristics_work_t *, problem_t *, state_t *, solution_t *,
+                 int);
+uchar randomized_heuristics(heuristics_work_t *, problem_t *, state_t *,
+                            solution_t *, int, uint *, int);
 
 #endif /* !HEURISTICS_H */
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "define.h"
+#include "lns.h"
+#include "print.h"
+#include "problem.h"
+#include "solution.h"
+#include "timer.h"
+
+/* maximum number of nodes for a window */
+#define LNS_MAX_N_NODE (100000)
+
+typedef struct {
+  problem_t *problem;
+  solution_t *solution;
+} lns_t;
+
+typedef struct {
+  lns_t *lns;
+  int index;
+  /* the best improvement found by this worker */
+  int start;
+  int end;
+  solution_t *window;
+  /* working area */
+  state_t **state;
+  state_t *target;
+  solution_t *csolution;
+  uchar tail;
+  ulint n_node;
+} lns_worker_t;
+
+static void *lns_worker(void *);
+static uchar lns_bb(lns_worker_t *, int, int);
+static int lns_lower_bound(problem_t *, lns_worker_t *, state_t *);
+static void lns_append(problem_t *, state_t *, solution_t *, int, int);
+
+/*
+ * large neighbourhood search
+ * every window of lns_window consecutive relocations is replaced by
+ * a shortest sequence between the same configurations, which is found
+ * by a small branch-and-bound.  the windows are shared among n_thread
+ * workers and the best improvement is applied until no window is
+ * improved or the time limit is reached.
+ *
+ */
+uchar lns(problem_t *problem, solution_t *solution)
+{
+  int i, k;
+  int n_relocation = solution->n_relocation;
+  lns_t lns;
+  lns_worker_t *worker;
+  pthread_t *thread;
+  solution_t *nsolution = create_solution();
+  state_t *state = NULL;
+
+  lns.problem = problem;
+  lns.solution = solution;
+
+  worker = (lns_worker_t *) malloc((size_t) n_thread*sizeof(lns_worker_t));
+  thread = (pthread_t *) malloc((size_t) n_thread*sizeof(pthread_t));
+  for(i = 0; i < n_thread; ++i) {
+    worker[i].lns = &lns;
+    worker[i].index = i;
+    worker[i].window = create_solution();
+    worker[i].csolution = create_solution();
+    worker[i].target = create_state(problem);
+    worker[i].state
+      = (state_t **) malloc((size_t) lns_window*sizeof(state_t *));
+    for(k = 0; k < lns_window; ++k) {
+      worker[i].state[k] = create_state(problem);
+    }
+  }
+
+  while(1) {
+    int best = -1;
+
+    if(tlimit > 0 && get_time(problem) >= (double) tlimit) {
+      break;
+    }
+
+    if(n_thread == 1) {
+      lns_worker((void *) &(worker[0]));
+    } else {
+      for(i = 0; i < n_thread; ++i) {
+        pthread_create(&(thread[i]), NULL, lns_worker, (void *) &(worker[i]));
+      }
+      for(i = 0; i < n_thread; ++i) {
+        pthread_join(thread[i], NULL);
+      }
+    }
+
+    /* the largest decrease, ties are broken by the earliest window */
+    for(i = 0; i < n_thread; ++i) {
+      if(worker[i].start >= 0
+         && (best < 0
+             || worker[i].end - worker[i].start
+             - worker[i].window->n_relocation
+             > worker[best].end - worker[best].start
+             - worker[best].window->n_relocation
+             || (worker[i].end - worker[i].start
+                 - worker[i].window->n_relocation
+                 == worker[best].end - worker[best].start
+                 - worker[best].window->n_relocation
+                 && worker[i].start < worker[best].start))) {
+        best = i;
+      }
+    }
+
+    if(best < 0) {
+      break;
+    }
+
+    /* splice the window into the solution */
+    state = initialize_state(problem, state);
+    nsolution->n_relocation = 0;
+    for(k = 0; k < solution->n_relocation; ++k) {
+      if(k == worker[best].start) {
+        for(i = 0; i < worker[best].window->n_relocation; ++i) {
+          lns_append(problem, state, nsolution,
+                     worker[best].window->relocation[i].src,
+                     worker[best].window->relocation[i].dst);
+        }
+      }
+      if(k < worker[best].start || k >= worker[best].end) {
+        /* blocks of the same priority may be interchanged */
+        lns_append(problem, state, nsolution, solution->relocation[k].src,
+                   solution->relocation[k].dst);
+      }
+    }
+
+    if(state->n_misoverlay > 0) {
+      break;
+    }
+
+    copy_solution(solution, nsolution);
+    fprintf(stderr, "ub=%d lns ", solution->n_relocation);
+    print_time(problem);
+  }
+
+  for(i = 0; i < n_thread; ++i) {
+    for(k = 0; k < lns_window; ++k) {
+      free_state(worker[i].state[k]);
+    }
+    free(worker[i].state);
+    free_state(worker[i].target);
+    free_solution(worker[i].csolution);
+    free_solution(worker[i].window);
+  }
+  free(thread);
+  free(worker);
+  free_state(state);
+  free_solution(nsolution);
+
+  return((solution->n_relocation < n_relocation)?True:False);
+}
+
+void *lns_worker(void *arg)
+{
+  int i, m;
+  int current = 0;
+  lns_worker_t *worker = (lns_worker_t *) arg;
+  problem_t *problem = worker->lns->problem;
+  solution_t *solution = worker->lns->solution;
+  state_t *state = initialize_state(problem, NULL);
+
+  worker->start = -1;
+
+  for(i = worker->index; i < solution->n_relocation; i += n_thread) {
+    int lb;
+    int end = min(i + lns_window, solution->n_relocation);
+
+    if(tlimit > 0 && get_time(problem) >= (double) tlimit) {
+      break;
+    }
+
+    /* replay the prefix */
+    for(; current < i; ++current) {
+      update_state(problem, state, solution->relocation[current].src,
+                   solution->relocation[current].dst);
+    }
+
+    /* configuration after the window */
+    copy_state(problem, worker->target, state);
+    for(m = i; m < end; ++m) {
+      update_state(problem, worker->target, solution->relocation[m].src,
+                   solution->relocation[m].dst);
+    }
+    /* the last window only has to reach a sorted configuration */
+    worker->tail = (end == solution->n_relocation)?True:False;
+
+    copy_state(problem, worker->state[0], state);
+    lb = lns_lower_bound(problem, worker, state);
+
+    worker->n_node = 0;
+    for(m = lb; m < end - i
+          && (worker->start < 0
+              || end - i - m > worker->end - worker->start
+              - worker->window->n_relocation); ++m) {
+      worker->csolution->n_relocation = 0;
+      if(lns_bb(worker, 0, m) == True) {
+        worker->start = i;
+        worker->end = end;
+        copy_solution(worker->window, worker->csolution);
+        break;
+      }
+      if(worker->n_node >= LNS_MAX_N_NODE) {
+        break;
+      }
+    }
+  }
+
+  free_state(state);
+
+  return(NULL);
+}
+
+/* relocation sequence of length depth from worker->state[level] */
+uchar lns_bb(lns_worker_t *worker, int level, int depth)
+{
+  int i, j;
+  problem_t *problem = worker->lns->problem;
+  state_t *cstate = worker->state[level];
+  stack_state_t *stack = cstate->stack;
+  int last_src = -1, last_dst = -1;
+  block_t block;
+
+  if(level == depth) {
+    return((lns_lower_bound(problem, worker, cstate) == 0)?True:False);
+  }
+
+  if(level + lns_lower_bound(problem, worker, cstate) > depth
+     || ++worker->n_node >= LNS_MAX_N_NODE) {
+    return(False);
+  }
+
+  if(level > 0) {
+    last_src = worker->csolution->relocation[level - 1].src;
+    last_dst = worker->csolution->relocation[level - 1].dst;
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    if(stack[i].n_tier == 0) {
+      continue;
+    }
+    for(j = 0; j < problem->n_stack; ++j) {
+      if(j == i || stack[j].n_tier == problem->s_height
+         || (i == last_dst && j == last_src)) {
+        continue;
+      }
+
+      copy_state(problem, worker->state[level + 1], cstate);
+      block = cstate->block[i][stack[i].n_tier - 1];
+      update_state(problem, worker->state[level + 1], i, j);
+
+      worker->csolution->n_relocation = level;
+      add_relocation(worker->csolution, i, j, &block);
+
+      if(lns_bb(worker, level + 1, depth) == True) {
+        return(True);
+      }
+    }
+  }
+
+  return(False);
+}
+
+/*
+ * lower bound on the relocations from cstate to the target configuration
+ * all the blocks above the lowest mismatch must be relocated
+ *
+ */
+int lns_lower_bound(problem_t *problem, lns_worker_t *worker,
+                    state_t *cstate)
+{
+  int i, j;
+  int lb = 0;
+
+  if(worker->tail == True) {
+    return(cstate->n_misoverlay);
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    int n_tier = cstate->stack[i].n_tier;
+
+    for(j = 0; j < n_tier && j < worker->target->stack[i].n_tier
+          && cstate->block[i][j].priority
+          == worker->target->block[i][j].priority; ++j);
+    lb += n_tier - j;
+  }
+
+  return(lb);
+}
+
+void lns_append(problem_t *problem, state_t *state, solution_t *solution,
+                int src, int dst)
+{
+  block_t block = state->block[src][state->stack[src].n_tier - 1];
+
+  update_state(problem, state, src, dst);
+  add_relocation(solution, src, dst, &block);
+}
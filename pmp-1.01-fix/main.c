@@ -35,30 +35,58 @@
 #include <string.h>
 #include <stdlib.h>
 #include "define.h"
+#include "batch.h"
+#include "beam.h"
+#include "bundle.h"
+#include "input.h"
+#include "lns.h"
+#include "presolve.h"
 #include "print.h"
 #include "problem.h"
+#include "serve.h"
 #include "solution.h"
 #include "solve.h"
+#include "stream.h"
+#include "timer.h"
 
-static problem_t *read_file(char *, int, int, int);
 static void usage(char *);
-static void remove_comments(char *);
-static int blockdata_comp(const void *, const void *);
+static int convert(char *, char *, int, int, int);
 
 int main(int argc, char **argv)
 {
   char **agv;
-  int n_stack, s_height, n_empty_tier;
-  uchar ret;
-  problem_t *problem;
+  char *batch_list = NULL, *socket_path = NULL, *bundle_file = NULL;
+  int n_stack, s_height, n_empty_tier, n_relocation, lb = 0;
+  uchar ret, stream_mode = False;
+  ulint n_node = 0;
+  solver_ctx_t *ctx;
+  problem_t *problem, *reduced = NULL;
   solution_t *solution;
 
-  verbose = False;
-  tlimit = -1;
   n_stack = s_height = 0;
   n_empty_tier = -1;
   for(agv = argv + 1, argc--; argc > 0 && agv[0][0] == '-'; --argc, ++agv) {
     switch(agv[0][1]) {
+    case '-':
+      if(strcmp(agv[0], "--stream") == 0) {
+        stream_mode = True;
+        break;
+      } else if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      } else if(strcmp(agv[0], "--batch") == 0) {
+        batch_list = agv[1];
+      } else if(strcmp(agv[0], "--serve") == 0) {
+        socket_path = agv[1];
+      } else if(strcmp(agv[0], "--bundle") == 0) {
+        bundle_file = agv[1];
+      } else {
+        usage(argv[0]);
+        return(1);
+      }
+      ++agv;
+      --argc;
+      break;
     default:
     case 'h':
       usage(argv[0]);
@@ -70,6 +98,18 @@ int main(int argc, char **argv)
     case 's':
       verbose = False;
       break;
+    case 'P':
+      pilot_method = True;
+      break;
+    case 'L':
+      lds_mode = True;
+      break;
+    case 'p':
+      presolve_mode = True;
+      break;
+    case 'H':
+      hybrid_mode = True;
+      break;
     case 'S':
       if(argc == 1) {
         usage(argv[0]);
@@ -106,9 +146,135 @@ int main(int argc, char **argv)
       ++agv;
       --argc;
       break;
+    case 'j':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      n_thread = max(1, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'D':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      lookahead_depth = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'Q':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      n_pdb = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'q':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      pdb_dir = agv[1];
+      ++agv;
+      --argc;
+      break;
+    case 'm':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      endgame_threshold = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'A':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      flow_depth = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'R':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      restart_unit = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'k':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      n_speculation = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'B':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      beam_width = atoi(agv[1]);
+      ++agv;
+      --argc;
+      break;
+    case 'N':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      lns_window = atoi(agv[1]);
+      ++agv;
+      --argc;
+      break;
+    case 'g':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      lb_gap = max(0, atoi(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'w':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      lb_weight = max(1.0, atof(agv[1]));
+      ++agv;
+      --argc;
+      break;
+    case 'G':
+      if(argc == 1) {
+        usage(argv[0]);
+        return(1);
+      }
+      grasp_time = atof(agv[1]);
+      ++agv;
+      --argc;
+      break;
     }
   }
 
+  if(batch_list != NULL) {
+    return(batch(batch_list, n_stack, s_height, n_empty_tier));
+  } else if(socket_path != NULL) {
+    return(serve(socket_path, n_stack, s_height, n_empty_tier));
+  } else if(bundle_file != NULL) {
+    return(convert(bundle_file, (argc >= 1)?agv[0]:"-", n_stack, s_height,
+                   n_empty_tier));
+  }
+
   problem = read_file((argc >= 1)?agv[0]:NULL, n_stack, s_height, n_empty_tier);
   if(problem == NULL) {
     return(0);
@@ -122,9 +288,50 @@ int main(int argc, char **argv)
 
   timer_start(problem);
 
-  ret = solve(problem, solution);
+  if(presolve_mode == True && (reduced = presolve(problem)) != NULL) {
+    fprintf(stderr, "presolve: %d tiers removed\n",
+            problem->s_height - reduced->s_height);
+    if(verbose == True) {
+      print_problem(reduced, stderr);
+    }
+  }
+
+  if(beam_width > 0) {
+    ret = beam_search((reduced != NULL)?reduced:problem, solution);
+    if(stream_mode == True && solution->n_relocation <= MAX_N_RELOCATION) {
+      stream_solution(stdout, solution, "beam", get_time(problem));
+    }
+  } else if(stream_mode == True) {
+    /* the events of the search are written to stdout as they happen */
+    ctx = create_solver_ctx();
+    solver_ctx_set_callback(ctx, stream_event, (void *) stdout);
+    ret = solve_ctx(ctx, (reduced != NULL)?reduced:problem, solution);
+    lb = solver_ctx_lower_bound(ctx);
+    n_node = solver_ctx_nodes(ctx);
+    free_solver_ctx(ctx);
+  } else {
+    ret = solve((reduced != NULL)?reduced:problem, solution);
+  }
+
+  if(reduced != NULL) {
+    postsolve(problem, reduced, solution);
+    free_problem(reduced);
+  }
+
+  if(ret != True && lns_window > 0
+     && solution->n_relocation <= MAX_N_RELOCATION) {
+    /* post-optimization of the best solution */
+    n_relocation = solution->n_relocation;
+    lns(problem, solution);
+    if(stream_mode == True && solution->n_relocation < n_relocation) {
+      stream_solution(stdout, solution, "lns", get_time(problem));
+    }
+  }
 
   print_time(problem);
+  if(stream_mode == True) {
+    stream_result(stdout, solution, ret, lb, n_node, problem->time);
+  }
   if(solution->n_relocation <= MAX_N_RELOCATION) {
     if(ret == True) {
       fprintf(stderr, "opt=%d\n", solution->n_relocation);
@@ -145,298 +352,77 @@ int main(int argc, char **argv)
 
 void usage(char *name)
 {
-  fprintf(stdout, "Usage: %s [-v|-s] [-S S] [-T T] [-E E] [-t L] "
+  fprintf(stdout, "Usage: %s [-v|-s] [-S S] [-T T] [-E E] [-t L] [-j J] "
+          "[-G G] [-P] [-B B] [-L] [-N N] [-g g] [-w w] [-k K] [-H] "
+          "[-R R] [-D D] [-p] [-Q Q] [-q dir] [-m M] [-A A] [--stream] "
           "[input file]\n",
           name);
+  fprintf(stdout, "       %s [options] --batch dir|list|-\n", name);
+  fprintf(stdout, "       %s [options] --serve socket\n", name);
+  fprintf(stdout, "       %s [-S S] [-T T] [-E E] --bundle output "
+          "[dir|list]\n", name);
   fprintf(stdout, "b&b algorithm for the premarshalling problem.\n");
   fprintf(stdout, " -v|-s: verbose|silent\n");
   fprintf(stdout, " -S  S: number of stacks.\n");
   fprintf(stdout, " -T  T: stack height.\n");
   fprintf(stdout, " -E  E: additional empty tiers.\n");
   fprintf(stdout, " -t  L: time limit.\n");
+  fprintf(stdout, " -j  J: number of threads (--batch, --serve: instances "
+          "solved concurrently).\n");
+  fprintf(stdout, " -G  G: time for GRASP at the root node.\n");
+  fprintf(stdout, " -P   : pilot method at the root node.\n");
+  fprintf(stdout, " -p   : remove the fixed bottom tiers before search.\n");
+  fprintf(stdout, " -B  B: beam search with beam width B.\n");
+  fprintf(stdout, " -L   : limited discrepancy search.\n");
+  fprintf(stdout, " -N  N: post-optimization with windows of N relocations.\n");
+  fprintf(stdout, " -g  g: stop when the gap is at most g.\n");
+  fprintf(stdout, " -w  w: weight (>=1) of the lower bound for pruning.\n");
+  fprintf(stdout, " -k  K: run K consecutive iterations concurrently.\n");
+  fprintf(stdout, " -H   : hybrid of IDA* and depth-first b&b.\n");
+  fprintf(stdout, " -R  R: restarts with random stack orders every R*luby(i) "
+          "nodes.\n");
+  fprintf(stdout, " -Q  Q: lower bound by Q pattern databases.\n");
+  fprintf(stdout, " -q  d: directory where pattern databases are stored.\n");
+  fprintf(stdout, " -D  D: lookahead of depth D for the root lower bound.\n");
+  fprintf(stdout, " -m  M: exact endgame with at most M misoverlaid blocks.\n");
+  fprintf(stdout, " -A  A: assignment lower bound up to depth A.\n");
+  fprintf(stdout, " --batch: solve the instances in a directory, a bundle "
+          "or listed in a file\n          (-: stdin).\n");
+  fprintf(stdout, " --serve: solve the instances sent to a unix domain "
+          "socket.\n");
+  fprintf(stdout, " --stream: write the improved solutions, the failed "
+          "iterations and the\n           lower bounds to stdout as JSON "
+          "lines.\n");
+  fprintf(stdout, " --bundle: convert the instances (default: listed in "
+          "stdin) into a bundle\n           for --batch.\n");
   fprintf(stdout, "\n");
 }
 
-typedef struct {
-  int s;
-  int t;
-  int priority;
-} blockdata_t;
-
-static struct {
-  int type;
-  char *key;
-} key_list[] = {
-  {0, "Tiers"},
-  {0, "Height"},
-  {1, "Width"},
-  {1, "Stacks"},
-  {2, "Containers"},
-  {3, "Stack "},
-  {-1, NULL}
-};
-
-problem_t *read_file(char *filename, int n_stack, int s_height,
-                     int n_empty_tier)
+/*
+ * write the instances in directory list or listed in file list
+ * to the bundle output
+ *
+ */
+int convert(char *output, char *list, int n_stack, int s_height,
+            int n_empty_tier)
 {
-  int i;
-  int n_block;
-  int current_block = 0, current_stack = 0, current_tier = 0;
-  uchar file_type = 0;
-  FILE *fp;
-  problem_t *problem;
-  char buf[MAXBUFLEN], *p;
-  blockdata_t *blockdata;
-
-  if(filename == NULL) {
-    fp = stdin;
-  } else {
-#ifdef _MSC_VER
-    if(fopen_s(&fp, filename, "r") != 0) {
-#else /* !_MSC_VER */
-    if((fp = fopen(filename, "r")) == NULL) {
-#endif /* !_MSC_VER */
-      fprintf(stderr, "Failed to open file: %s\n", filename);
-      return(NULL);
-    }
-  }
-
-  problem = NULL;
-  while(fgets(buf, MAXBUFLEN, fp) != NULL) {
-    int dn_stack;
-
-    remove_comments(buf);
-    for(p = buf; *p == ' ' || *p == '\t'; ++p);
-    if(*p == '\0') {
-      continue;
-    }
-    if(strchr(p, ':') != NULL) {
-      int type = -1;
-      int val;
-
-      for(i = 0; key_list[i].type != -1; ++i) {
-        if(strncmp(key_list[i].key, p, strlen(key_list[i].key)) == 0) {
-          type = key_list[i].type;
-          p += strlen(key_list[i].key);
-          break;
-        }
-      }
-
-      if(type == -1) {
-        continue;
-      } else if(type == 3) {
-        file_type = 1;
-        break;
-      }
-
-      for(; *p != ':' && *p != '\0'; ++p);
-      if(*p == ':') {
-        ++p;
-      }
-      val = (int) strtol(p, NULL, 10);
-
-      switch(type) {
-      default:
-      case 0:
-        if(n_empty_tier > 0) {
-          s_height = val + n_empty_tier;
-        } else {
-          s_height = val;
-        }
-        break;
-        
-      case 1:
-        n_stack = max(n_stack, val);
-        break;
-
-      case 2:
-        n_block = val;
-        break;
-      }
-    } else {
-#ifdef _MSC_VER
-      if(sscanf_s(buf, "%d %d", &dn_stack, &n_block) == 2) {
-#else /* !_MSC_VER */
-      if(sscanf(buf, "%d %d", &dn_stack, &n_block) == 2) {
-#endif /* !_MSC_VER */
-        n_stack = max(n_stack, dn_stack);
-        if(s_height == 0 && n_empty_tier == -1) {
-          s_height = n_block;
-        }
-        break;
-#ifdef _MSC_VER
-      }
-#else /* !_MSC_VER */
-      }
-#endif /* !_MSC_VER */
-    }
-  }
-
-  if(n_block == 0 || n_stack == 0) {
-    problem = NULL;
-    goto read_file_end;
-  }
-
-  problem = create_problem(n_stack, s_height, n_block);
-  blockdata = calloc((size_t) n_block, sizeof(blockdata_t));
-
-  if(file_type == 0) {
-    int i;
-    int n_tier = 0;
-
-    while(current_stack < n_stack && current_block < n_block
-          && fgets(buf, MAXBUFLEN, fp) != NULL) {
-      char *nptr, *endptr;
-
-      remove_comments(buf);
-      nptr = buf;
+  int i, n, n_written;
+  char **filename;
 
-      while(1) {
-        i = (int) strtol(nptr, &endptr, 10);
-        if(nptr == endptr) {
-          break;
-        } else {
-          nptr = endptr;
-        }
-
-        if(n_tier == 0) {
-          problem->n_tier[current_stack] = n_tier = i;
-          problem->s_height = max(problem->s_height, i);
-          if(n_tier == 0) {
-            if(++current_stack == n_stack) {
-              break;
-            }
-          }
-          current_tier = 0;
-        } else {
-          blockdata[current_block].s = current_stack;
-          blockdata[current_block].t = current_tier;
-          blockdata[current_block].priority = i;
-          if(++current_block == n_block) {
-            break;
-          }
-          if(++current_tier == n_tier) {
-            if(++current_stack == n_stack) {
-              break;
-            }
-            n_tier = current_tier = 0;
-          }
-        }
-      }
-    }
-
-    if(problem->s_height != n_block && n_empty_tier > 0) {
-      problem->s_height += n_empty_tier;
-    }
-  } else {
-    do {
-      char *endptr;
-
-      for(p = buf; *p == ' ' || *p == '\t'; ++p);
-      if(strncmp("Stack ", p, strlen("Stack ")) != 0) {
-        continue;
-      }
-
-      for(p += strlen("Stack "); *p != ':' && *p != '\0'; ++p);
-      if(*p == ':') {
-        ++p;
-      }
-
-      current_tier = 0;
-      while(current_block < n_block) {
-        int val = (int) strtol(p, &endptr, 10);
-
-        if(p == endptr) {
-          break;
-        } else {
-          p = endptr;
-        }
-
-        blockdata[current_block].s = current_stack;
-        blockdata[current_block].t = current_tier++;
-        blockdata[current_block++].priority = val;
-      }
-
-      problem->n_tier[current_stack++] = current_tier;
-      s_height = max(s_height, current_tier);
-    } while(fgets(buf, MAXBUFLEN, fp) != NULL);
-  }
-
-  if(n_block != current_block) {
-    free_problem(problem);
-    problem = NULL;
-  } else {
-    int min_priority, priority = -1, prev_priority = -1;
-
-    qsort((void *) blockdata, n_block, sizeof(blockdata_t), blockdata_comp);
-
-    problem->block[0]
-      = (block_t *) calloc((size_t) problem->n_stack*problem->s_height,
-                           sizeof(block_t));
-    for(i = 1; i < problem->n_stack; ++i) {
-      problem->block[i] = problem->block[i - 1] + problem->s_height;
-    }
-
-    min_priority = blockdata[0].priority;
-    for(i = 0; i < n_block; ++i) {
-      problem->priority[i] = blockdata[i].priority;
-      blockdata[i].priority -= min_priority;
-    }
-    for(i = 0; i < n_block; ++i) {
-      if(blockdata[i].priority > prev_priority) {
-        ++priority;
-        prev_priority = blockdata[i].priority;
-      }
-      problem->position[i].s = blockdata[i].s;
-      problem->position[i].t = blockdata[i].t;
-      problem->block[blockdata[i].s][blockdata[i].t].no = i;
-      problem->block[blockdata[i].s][blockdata[i].t].priority = priority;
-    }
-
-    problem->max_priority = priority;
-
-    if(problem->max_priority < problem->n_block - 1) {
-      problem->duplicate = True;
-    }
+  if((n = batch_list(list, &filename)) < 0) {
+    return(1);
   }
 
-  free(blockdata);
-
-  read_file_end:
-  if(filename != NULL) {
-    fclose(fp);
+  n_written = write_bundle(output, n, filename, n_stack, s_height,
+                           n_empty_tier);
+  if(n_written >= 0) {
+    fprintf(stderr, "%d instances written to %s\n", n_written, output);
   }
 
-  return(problem);
-}
-
-void remove_comments(char *c)
-{
-  char *a = c;
-
-  for(; *c == ' ' || *c == '\t'; ++c);
-  for(; *c != '\0' && *c != '#' && *c != '\n'; *a++ = *c, ++c);
-  *a='\0';
-}
-
-int blockdata_comp(const void *a, const void *b)
-{
-  blockdata_t *x = (blockdata_t *) a;
-  blockdata_t *y = (blockdata_t *) b;
-
-  if(x->priority > y->priority) {
-    return(1);
-  } else if(x->priority < y->priority) {
-    return(-1);
-  } else if(x->t < y->t) {
-    return(1);
-  } else if(x->t > y->t) {
-    return(-1);
-  } else if(x->s > y->s) {
-    return(1);
-  } else if(x->s < y->s) {
-    return(-1);
+  for(i = 0; i < n; ++i) {
+    free(filename[i]);
   }
+  free(filename);
 
-  return(0);
+  return((n_written >= 0)?0:1);
 }
@@ -0,0 +1,459 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "define.h"
+#include "pdb.h"
+#include "print.h"
+#include "problem.h"
+#include "solution.h"
+
+/* maximum number of abstract states in a table */
+#define PDB_MAX_STATE (1<<22)
+
+#define PDB_MAGIC "PMPPDB1"
+
+/*
+ * pattern databases
+ * a state is abstracted by classifying the blocks into high (priority
+ * >= threshold) and low ones.  the stacks of the abstract state are
+ * encoded from the bottom with a leading 1 bit, and the sorted codes
+ * are packed into a 64-bit key.  a table keeps the exact number of
+ * relocations of all the abstract states, computed by breadth-first
+ * search from the clean abstract states.  every solution of the
+ * original problem is also a solution of the abstract one, so the
+ * table gives a lower bound.
+ *
+ * the tables only depend on n_stack, s_height and the number of high
+ * and low blocks.  with pdb_dir, they are stored in files and mapped
+ * into memory, so that processes solving similar instances share them.
+ *
+ */
+typedef struct {
+  char magic[8];
+  int n_stack;
+  int s_height;
+  int n_high;
+  int n_low;
+  ulint capacity;
+} pdb_header_t;
+
+typedef struct {
+  int threshold;
+  int width;
+  int shift;
+  ulint capacity;
+  ulint *key;
+  uchar *cost;
+  void *map;
+  size_t map_size;
+} pdb_table_t;
+
+struct pdb {
+  int n_table;
+  pdb_table_t *table;
+};
+
+static double count_state(int, int, int, int);
+static void build_pdb(problem_t *, pdb_table_t *, int, int, ulint);
+static uchar load_pdb(char *, pdb_table_t *, pdb_header_t *);
+static void save_pdb(char *, pdb_table_t *, pdb_header_t *);
+static void enumerate_goal(pdb_table_t *, int, int, int, int, ulint *, int, int,
+                           ulint *, ulint *);
+static ulint pack_key(ulint *, int, int);
+static ulint *lookup(pdb_table_t *, ulint);
+
+/*
+ * at most n_pdb tables for problem (NULL: too many stacks or tiers).
+ * the tables are stored in pdb_dir (NULL: not stored)
+ *
+ */
+pdb_t *create_pdb(problem_t *problem, int n_pdb, char *pdb_dir)
+{
+  int i, k, n_high, n_low, prev_threshold = problem->max_priority + 1;
+  int *n_priority;
+  double n_state;
+  char filename[MAXBUFLEN];
+  pdb_header_t header;
+  pdb_table_t *pdb;
+  pdb_t *pdbs;
+
+  if(problem->n_stack*(problem->s_height + 1) > 64) {
+    fprintf(stderr, "pdb: too many stacks or tiers\n");
+    return(NULL);
+  }
+
+  /* n_priority[p]: the number of blocks with priority p or more */
+  n_priority = (int *) calloc((size_t) problem->max_priority + 2, sizeof(int));
+  for(i = 0; i < problem->n_stack; ++i) {
+    for(k = 0; k < problem->n_tier[i]; ++k) {
+      ++n_priority[problem->block[i][k].priority];
+    }
+  }
+  for(i = problem->max_priority - 1; i >= 0; --i) {
+    n_priority[i] += n_priority[i + 1];
+  }
+
+  pdbs = (pdb_t *) malloc(sizeof(pdb_t));
+  pdbs->n_table = 0;
+  pdbs->table = (pdb_table_t *) calloc((size_t) n_pdb, sizeof(pdb_table_t));
+
+  for(k = 0; k < n_pdb; ++k) {
+    pdb = &(pdbs->table[pdbs->n_table]);
+
+    /* about (k + 1)/(n_pdb + 1) of the blocks are high */
+    for(i = 1; i <= problem->max_priority
+          && n_priority[i]*(n_pdb + 1) > problem->n_block*(k + 1); ++i);
+    /* fewer high blocks until the table is small enough */
+    for(; i <= problem->max_priority; ++i) {
+      n_state = count_state(problem->n_stack, problem->s_height,
+                            n_priority[i], problem->n_block - n_priority[i]);
+      if(n_state <= (double) PDB_MAX_STATE) {
+        break;
+      }
+    }
+    if(i > problem->max_priority || i >= prev_threshold) {
+      continue;
+    }
+    prev_threshold = pdb->threshold = i;
+    n_high = n_priority[i];
+    n_low = problem->n_block - n_high;
+
+    pdb->width = problem->s_height + 1;
+    for(pdb->shift = 64, pdb->capacity = 1;
+        (double) pdb->capacity < 2.0*n_state; pdb->capacity <<= 1,
+          --pdb->shift);
+
+    memset((void *) &header, 0, sizeof(pdb_header_t));
+    strcpy(header.magic, PDB_MAGIC);
+    header.n_stack = problem->n_stack;
+    header.s_height = problem->s_height;
+    header.n_high = n_high;
+    header.n_low = n_low;
+    header.capacity = pdb->capacity;
+
+    if(pdb_dir != NULL) {
+      snprintf(filename, MAXBUFLEN, "%s/pmp-%d-%d-%d-%d.pdb", pdb_dir,
+               problem->n_stack, problem->s_height, n_high, n_low);
+      if(load_pdb(filename, pdb, &header) == True) {
+        fprintf(stderr, "pdb threshold=%d states=%.0f loaded ",
+                pdb->threshold, n_state);
+        print_time(problem);
+        ++pdbs->n_table;
+        continue;
+      }
+    }
+
+    build_pdb(problem, pdb, n_high, n_low, (ulint) n_state);
+    fprintf(stderr, "pdb threshold=%d states=%.0f ", pdb->threshold, n_state);
+    print_time(problem);
+    if(pdb_dir != NULL) {
+      save_pdb(filename, pdb, &header);
+    }
+    ++pdbs->n_table;
+  }
+
+  free(n_priority);
+
+  return(pdbs);
+}
+
+void free_pdb(pdb_t *pdbs)
+{
+  int k;
+
+  if(pdbs == NULL) {
+    return;
+  }
+
+  for(k = 0; k < pdbs->n_table; ++k) {
+    if(pdbs->table[k].map != NULL) {
+      munmap(pdbs->table[k].map, pdbs->table[k].map_size);
+    } else {
+      free(pdbs->table[k].key);
+      free(pdbs->table[k].cost);
+    }
+  }
+  free(pdbs->table);
+  free(pdbs);
+}
+
+/* the tables are only read, and shared by the threads */
+int pdb_lower_bound(pdb_t *pdbs, problem_t *problem, state_t *state)
+{
+  int i, j, k, lb = 0;
+  ulint code[64];
+  ulint *key;
+  pdb_table_t *pdb;
+
+  for(k = 0; k < pdbs->n_table; ++k) {
+    pdb = &(pdbs->table[k]);
+    for(i = 0; i < problem->n_stack; ++i) {
+      code[i] = 1;
+      for(j = 0; j < state->stack[i].n_tier; ++j) {
+        code[i] = (code[i] << 1)
+          | ((state->block[i][j].priority >= pdb->threshold)?1:0);
+      }
+    }
+    if((key = lookup(pdb, pack_key(code, problem->n_stack, pdb->width)))
+       != NULL && *key != 0) {
+      lb = max(lb, (int) pdb->cost[key - pdb->key]);
+    }
+  }
+
+  return(lb);
+}
+
+/*
+ * the number of multisets of n_stack stacks with n_high high blocks
+ * and n_low low blocks
+ *
+ */
+double count_state(int n_stack, int s_height, int n_high, int n_low)
+{
+  int i, j, h, l, a, b;
+  uint c;
+  double *n = (double *) calloc((size_t) (n_stack + 1)*(n_high + 1)
+                                *(n_low + 1), sizeof(double));
+  double ret;
+
+#define N(s, h, l) n[((s)*(n_high + 1) + (h))*(n_low + 1) + (l)]
+  N(0, 0, 0) = 1.0;
+  for(i = 0; i <= s_height; ++i) {
+    for(c = 0; c < (1U << i); ++c) {
+      for(a = 0, b = (int) c; b != 0; b >>= 1) {
+        a += b & 1;
+      }
+      b = i - a;
+      for(j = 1; j <= n_stack; ++j) {
+        for(h = a; h <= n_high; ++h) {
+          for(l = b; l <= n_low; ++l) {
+            N(j, h, l) += N(j - 1, h - a, l - b);
+          }
+        }
+      }
+    }
+  }
+  ret = N(n_stack, n_high, n_low);
+#undef N
+
+  free(n);
+
+  return(ret);
+}
+
+void build_pdb(problem_t *problem, pdb_table_t *pdb, int n_high, int n_low,
+               ulint n_state)
+{
+  int i, j, s = problem->n_stack, h = problem->s_height;
+  uchar cost;
+  ulint head, tail, len_j, bit, t;
+  ulint code[64], stack[64];
+  ulint *queue = (ulint *) malloc((size_t) (n_state + 1)*sizeof(ulint));
+  ulint *key;
+
+  pdb->key = (ulint *) calloc((size_t) pdb->capacity, sizeof(ulint));
+  pdb->cost = (uchar *) calloc((size_t) pdb->capacity, sizeof(uchar));
+  pdb->map = NULL;
+
+  tail = 0;
+  enumerate_goal(pdb, s, h, n_high, n_low, stack, 0, 0, queue, &tail);
+
+  for(head = 0; head < tail; ++head) {
+    cost = pdb->cost[lookup(pdb, queue[head]) - pdb->key];
+    for(i = 0; i < s; ++i) {
+      code[i] = (queue[head] >> (i*pdb->width))
+        & ((((ulint) 1) << pdb->width) - 1);
+    }
+    for(i = 0; i < s; ++i) {
+      if(code[i] == 1 || (i > 0 && code[i] == code[i - 1])) {
+        /* empty, or the same as the previous stack */
+        continue;
+      }
+      bit = code[i] & 1;
+      for(j = 0; j < s; ++j) {
+        if(i == j || (j > 0 && j - 1 != i && code[j] == code[j - 1])) {
+          continue;
+        }
+        for(len_j = 0; (code[j] >> (len_j + 1)) != 0; ++len_j);
+        if(len_j == (ulint) h) {
+          continue;
+        }
+        memcpy((void *) stack, (void *) code, (size_t) s*sizeof(ulint));
+        stack[i] >>= 1;
+        stack[j] = (stack[j] << 1) | bit;
+        t = pack_key(stack, s, pdb->width);
+        key = lookup(pdb, t);
+        if(*key == 0 && tail < n_state) {
+          *key = t;
+          pdb->cost[key - pdb->key] = (uchar) min(255, cost + 1);
+          queue[tail++] = t;
+        }
+      }
+    }
+  }
+
+  free(queue);
+}
+
+/*
+ * clean abstract states: high blocks below low blocks in every stack
+ * the stacks are enumerated in non-increasing order of the codes
+ *
+ */
+void enumerate_goal(pdb_table_t *pdb, int s, int h, int n_high, int n_low,
+                    ulint *stack, int depth, int max_code, ulint *queue,
+                    ulint *tail)
+{
+  int a, b;
+  ulint code, *key;
+
+  if(depth == s) {
+    if(n_high == 0 && n_low == 0) {
+      key = lookup(pdb, code = pack_key(stack, s, pdb->width));
+      if(*key == 0) {
+        *key = code;
+        queue[(*tail)++] = code;
+      }
+    }
+    return;
+  }
+
+  for(a = 0; a <= min(h, n_high); ++a) {
+    for(b = 0; a + b <= h && b <= n_low; ++b) {
+      code = ((((ulint) 1) << (a + 1)) - 1) << b;
+      if(depth > 0 && code > (ulint) max_code) {
+        continue;
+      }
+      stack[depth] = code;
+      enumerate_goal(pdb, s, h, n_high - a, n_low - b, stack, depth + 1,
+                     (int) code, queue, tail);
+    }
+  }
+}
+
+/* sort the codes in non-increasing order and pack them */
+ulint pack_key(ulint *code, int n_stack, int width)
+{
+  int i, j;
+  ulint c, key = 0;
+
+  for(i = 1; i < n_stack; ++i) {
+    c = code[i];
+    for(j = i; j > 0 && code[j - 1] < c; --j) {
+      code[j] = code[j - 1];
+    }
+    code[j] = c;
+  }
+
+  for(i = n_stack - 1; i >= 0; --i) {
+    key = (key << width) | code[i];
+  }
+
+  return(key);
+}
+
+/* slot of key (an empty one if not found) */
+ulint *lookup(pdb_table_t *pdb, ulint key)
+{
+  ulint i = (key*0x9E3779B97F4A7C15ULL) >> pdb->shift;
+
+  while(pdb->key[i] != 0 && pdb->key[i] != key) {
+    i = (i + 1) & (pdb->capacity - 1);
+  }
+
+  return(&(pdb->key[i]));
+}
+
+uchar load_pdb(char *filename, pdb_table_t *pdb, pdb_header_t *header)
+{
+  int fd;
+  struct stat st;
+  size_t size = sizeof(pdb_header_t)
+    + (size_t) header->capacity*(sizeof(ulint) + sizeof(uchar));
+  void *map;
+
+  if((fd = open(filename, O_RDONLY)) < 0) {
+    return(False);
+  }
+  if(fstat(fd, &st) < 0 || (size_t) st.st_size != size) {
+    close(fd);
+    return(False);
+  }
+  map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    return(False);
+  }
+  if(memcmp(map, (void *) header, sizeof(pdb_header_t)) != 0) {
+    munmap(map, size);
+    return(False);
+  }
+
+  pdb->map = map;
+  pdb->map_size = size;
+  pdb->key = (ulint *) ((char *) map + sizeof(pdb_header_t));
+  pdb->cost = (uchar *) (pdb->key + header->capacity);
+
+  return(True);
+}
+
+void save_pdb(char *filename, pdb_table_t *pdb, pdb_header_t *header)
+{
+  char tmpname[MAXBUFLEN + 16];
+  FILE *fp;
+
+  /* write to a temporary file first, so readers never see a partial one */
+  snprintf(tmpname, MAXBUFLEN + 16, "%s.%d", filename, (int) getpid());
+  if((fp = fopen(tmpname, "wb")) == NULL) {
+    fprintf(stderr, "Failed to open file: %s\n", tmpname);
+    return;
+  }
+  if(fwrite((void *) header, sizeof(pdb_header_t), 1, fp) != 1
+     || fwrite((void *) pdb->key, sizeof(ulint), (size_t) pdb->capacity, fp)
+     != (size_t) pdb->capacity
+     || fwrite((void *) pdb->cost, sizeof(uchar), (size_t) pdb->capacity, fp)
+     != (size_t) pdb->capacity) {
+    fclose(fp);
+    remove(tmpname);
+    return;
+  }
+  fclose(fp);
+  rename(tmpname, filename);
+}
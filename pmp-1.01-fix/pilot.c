@@ -0,0 +1,234 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "define.h"
+#include "heuristics.h"
+#include "pilot.h"
+#include "print.h"
+#include "problem.h"
+#include "solution.h"
+#include "timer.h"
+
+typedef struct {
+  int src;
+  int dst;
+  int score;
+} pilot_move_t;
+
+typedef struct {
+  problem_t *problem;
+  state_t *state;
+  solution_t *prefix;
+  pilot_move_t *move;
+  int n_move;
+  int upper_bound;
+  int n_worker;
+} pilot_t;
+
+typedef struct {
+  pilot_t *pilot;
+  int index;
+  solution_t *solution;
+  heuristics_work_t *work;
+} pilot_worker_t;
+
+static void *pilot_worker(void *);
+
+/*
+ * pilot method
+ * every relocation from the current state is evaluated by completing it
+ * with the greedy heuristic, and the best one is fixed.  evaluations in
+ * a step are shared among n_worker threads.  solution is updated when
+ * a better one is found.  no step is started after tlimit (0: no limit).
+ *
+ */
+uchar pilot(problem_t *problem, state_t *state, solution_t *solution,
+            double tlimit, int n_worker)
+{
+  int i, j, k;
+  int n_relocation = solution->n_relocation;
+  int max_n_move = problem->n_stack*(problem->n_stack - 1);
+  pilot_t pilot;
+  pilot_worker_t *worker;
+  pthread_t *thread;
+  stack_state_t *stack;
+  block_t block;
+
+  pilot.problem = problem;
+  pilot.n_worker = n_worker;
+  pilot.state = duplicate_state(problem, state);
+  pilot.prefix = create_solution();
+  pilot.move = (pilot_move_t *) malloc((size_t) max_n_move
+                                       *sizeof(pilot_move_t));
+
+  worker
+    = (pilot_worker_t *) malloc((size_t) n_worker*sizeof(pilot_worker_t));
+  thread = (pthread_t *) malloc((size_t) n_worker*sizeof(pthread_t));
+  for(i = 0; i < n_worker; ++i) {
+    worker[i].pilot = &pilot;
+    worker[i].index = i;
+    worker[i].solution = create_solution();
+    worker[i].work = create_heuristics_work(problem);
+  }
+
+  stack = pilot.state->stack;
+  while(pilot.state->n_misoverlay > 0
+        && pilot.prefix->n_relocation + 1 < solution->n_relocation) {
+    int last_src = -1, last_dst = -1;
+    int best = -1;
+
+    if(tlimit > 0.0 && get_time(problem) >= tlimit) {
+      break;
+    }
+
+    if(pilot.prefix->n_relocation > 0) {
+      last_src = pilot.prefix->relocation[pilot.prefix->n_relocation - 1].src;
+      last_dst = pilot.prefix->relocation[pilot.prefix->n_relocation - 1].dst;
+    }
+
+    /* candidate relocations */
+    pilot.n_move = 0;
+    for(i = 0; i < problem->n_stack; ++i) {
+      if(stack[i].n_tier == 0) {
+        continue;
+      }
+      for(j = 0; j < problem->n_stack; ++j) {
+        if(j == i || stack[j].n_tier == problem->s_height
+           || (i == last_dst && j == last_src)) {
+          continue;
+        }
+        pilot.move[pilot.n_move].src = i;
+        pilot.move[pilot.n_move++].dst = j;
+      }
+    }
+
+    /* ties with the incumbent are accepted to keep on its path */
+    pilot.upper_bound = solution->n_relocation + 1;
+
+    if(n_worker == 1) {
+      pilot_worker((void *) &(worker[0]));
+    } else {
+      for(i = 0; i < n_worker; ++i) {
+        pthread_create(&(thread[i]), NULL, pilot_worker,
+                       (void *) &(worker[i]));
+      }
+      for(i = 0; i < n_worker; ++i) {
+        pthread_join(thread[i], NULL);
+      }
+    }
+
+    for(k = 0; k < pilot.n_move; ++k) {
+      if(pilot.move[k].score <= MAX_N_RELOCATION
+         && (best < 0 || pilot.move[k].score < pilot.move[best].score)) {
+        best = k;
+      }
+    }
+
+    if(best < 0) {
+      /* no completion is found */
+      break;
+    }
+
+    for(i = 0; i < n_worker; ++i) {
+      if(worker[i].solution->n_relocation < solution->n_relocation) {
+        copy_solution(solution, worker[i].solution);
+        fprintf(stderr, "ub=%d pilot ", solution->n_relocation);
+        print_time(problem);
+      }
+    }
+
+    /* fix the best relocation */
+    i = pilot.move[best].src;
+    j = pilot.move[best].dst;
+    block = pilot.state->block[i][stack[i].n_tier - 1];
+    update_state(problem, pilot.state, i, j);
+    add_relocation(pilot.prefix, i, j, &block);
+  }
+
+  for(i = 0; i < n_worker; ++i) {
+    free_heuristics_work(worker[i].work);
+    free_solution(worker[i].solution);
+  }
+  free(thread);
+  free(worker);
+  free(pilot.move);
+  free_solution(pilot.prefix);
+  free_state(pilot.state);
+
+  return((solution->n_relocation < n_relocation)?True:False);
+}
+
+void *pilot_worker(void *arg)
+{
+  int k;
+  pilot_worker_t *worker = (pilot_worker_t *) arg;
+  pilot_t *pilot = worker->pilot;
+  problem_t *problem = pilot->problem;
+  state_t *cstate = duplicate_state(problem, pilot->state);
+  solution_t *csolution = create_solution();
+  block_t block;
+
+  worker->solution->n_relocation = MAX_N_RELOCATION + 1;
+
+  for(k = worker->index; k < pilot->n_move; k += pilot->n_worker) {
+    int src = pilot->move[k].src;
+    int dst = pilot->move[k].dst;
+
+    copy_state(problem, cstate, pilot->state);
+    copy_solution(csolution, pilot->prefix);
+
+    block = cstate->block[src][cstate->stack[src].n_tier - 1];
+    update_state(problem, cstate, src, dst);
+    add_relocation(csolution, src, dst, &block);
+
+    if(cstate->n_misoverlay == 0
+       || heuristics(worker->work, problem, cstate, csolution,
+                     pilot->upper_bound)) {
+      pilot->move[k].score = csolution->n_relocation;
+      if(csolution->n_relocation < worker->solution->n_relocation) {
+        copy_solution(worker->solution, csolution);
+      }
+    } else {
+      pilot->move[k].score = MAX_N_RELOCATION + 1;
+    }
+  }
+
+  free_solution(csolution);
+  free_state(cstate);
+
+  return(NULL);
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "define.h"
+#include "pmp.h"
+#include "problem.h"
+#include "solution.h"
+#include "solve.h"
+#include "timer.h"
+
+typedef struct {
+  int s;
+  int t;
+  int priority;
+} pmp_block_t;
+
+static int pmp_block_comp(const void *, const void *);
+
+void pmp_default_option(pmp_option_t *option)
+{
+  option->tlimit = (double) tlimit;
+  option->gap = lb_gap;
+  option->n_thread = n_thread;
+  option->callback = NULL;
+  option->callback_arg = NULL;
+  solver_default_option(&(option->solver));
+}
+
+/*
+ * n_tier[s]: number of blocks in stack s
+ * priority: priorities of the blocks stack by stack from the bottom tier
+ * (sum of n_tier[s] entries, the smaller the earlier retrieved)
+ * returns NULL if the data are inconsistent.
+ *
+ */
+problem_t *pmp_create_problem(int n_stack, int s_height, int *n_tier,
+                              int *priority)
+{
+  int i, s, t;
+  int n_block = 0;
+  int min_priority, cpriority = -1, prev_priority = -1;
+  problem_t *problem;
+  pmp_block_t *blockdata;
+
+  if(n_stack <= 0 || s_height <= 0 || n_tier == NULL || priority == NULL) {
+    return(NULL);
+  }
+
+  for(s = 0; s < n_stack; ++s) {
+    if(n_tier[s] < 0 || n_tier[s] > s_height) {
+      return(NULL);
+    }
+    n_block += n_tier[s];
+  }
+
+  if(n_block == 0) {
+    return(NULL);
+  }
+
+  problem = create_problem(n_stack, s_height, n_block);
+  blockdata = (pmp_block_t *) malloc((size_t) n_block*sizeof(pmp_block_t));
+
+  for(s = 0, i = 0; s < n_stack; ++s) {
+    problem->n_tier[s] = n_tier[s];
+    for(t = 0; t < n_tier[s]; ++t, ++i) {
+      blockdata[i].s = s;
+      blockdata[i].t = t;
+      blockdata[i].priority = priority[i];
+    }
+  }
+
+  /* the same numbering of the blocks as in read_file() */
+  qsort((void *) blockdata, n_block, sizeof(pmp_block_t), pmp_block_comp);
+
+  problem->block[0]
+    = (block_t *) calloc((size_t) n_stack*s_height, sizeof(block_t));
+  for(s = 1; s < n_stack; ++s) {
+    problem->block[s] = problem->block[s - 1] + s_height;
+  }
+
+  min_priority = blockdata[0].priority;
+  for(i = 0; i < n_block; ++i) {
+    problem->priority[i] = blockdata[i].priority;
+    if(blockdata[i].priority - min_priority > prev_priority) {
+      ++cpriority;
+      prev_priority = blockdata[i].priority - min_priority;
+    }
+    problem->position[i].s = blockdata[i].s;
+    problem->position[i].t = blockdata[i].t;
+    problem->block[blockdata[i].s][blockdata[i].t].no = i;
+    problem->block[blockdata[i].s][blockdata[i].t].priority = cpriority;
+  }
+
+  problem->max_priority = cpriority;
+  if(problem->max_priority < problem->n_block - 1) {
+    problem->duplicate = True;
+  }
+
+  free(blockdata);
+
+  return(problem);
+}
+
+/*
+ * solves problem with the working area of ctx (NULL: a temporary one)
+ * option == NULL: pmp_default_option().  statistics may be NULL.
+ *
+ */
+uchar pmp_solve(solver_ctx_t *ctx, problem_t *problem, pmp_option_t *option,
+                solution_t *solution, pmp_statistics_t *statistics)
+{
+  uchar ret;
+  pmp_option_t default_option;
+  solver_ctx_t *cctx = (ctx == NULL)?create_solver_ctx():ctx;
+
+  if(option == NULL) {
+    pmp_default_option(&default_option);
+    option = &default_option;
+  }
+
+  solver_ctx_set_limit(cctx, option->tlimit, option->gap);
+  solver_ctx_set_callback(cctx, option->callback, option->callback_arg);
+  solver_ctx_set_option(cctx, &(option->solver));
+  /* n_thread <= 0: the process-wide setting */
+  solver_ctx_set_threads(cctx,
+                         (option->n_thread > 0)?option->n_thread:n_thread);
+
+  timer_start(problem);
+  ret = solve_ctx(cctx, problem, solution);
+  set_time(problem);
+
+  if(statistics != NULL) {
+    statistics->optimal = (ret == True)?True:False;
+    statistics->feasible
+      = (solution->n_relocation <= MAX_N_RELOCATION)?True:False;
+    statistics->n_relocation = solution->n_relocation;
+    statistics->lb = solver_ctx_lower_bound(cctx);
+    statistics->n_node = solver_ctx_nodes(cctx);
+    statistics->time = problem->time;
+  }
+
+  if(ctx == NULL) {
+    free_solver_ctx(cctx);
+  }
+
+  return(ret);
+}
+
+int pmp_block_comp(const void *a, const void *b)
+{
+  pmp_block_t *x = (pmp_block_t *) a;
+  pmp_block_t *y = (pmp_block_t *) b;
+
+  if(x->priority > y->priority) {
+    return(1);
+  } else if(x->priority < y->priority) {
+    return(-1);
+  } else if(x->t < y->t) {
+    return(1);
+  } else if(x->t > y->t) {
+    return(-1);
+  } else if(x->s > y->s) {
+    return(1);
+  } else if(x->s < y->s) {
+    return(-1);
+  }
+
+  return(0);
+}
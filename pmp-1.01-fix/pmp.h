@@ -0,0 +1,82 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#ifndef PMP_H
+#define PMP_H
+#include "define.h"
+#include "problem.h"
+#include "solution.h"
+#include "solve.h"
+
+/*
+ * library interface (libpmp.a, libpmp.so)
+ * pmp_solve() may be called concurrently on different threads with
+ * different contexts (or ctx == NULL) and different options.  it does
+ * not change the global settings declared in problem.h, which only give
+ * the defaults of pmp_default_option().  the state of a search is
+ * owned by its context (see solver_ctx_t in solve.h).
+ *
+ */
+typedef struct {
+  /* time limit in seconds (<= 0: no limit) */
+  double tlimit;
+  /* the search stops when the gap is at most gap */
+  int gap;
+  /* number of threads of the parallel heuristics and the lookahead */
+  /* of this call (<= 0: the global n_thread) */
+  int n_thread;
+  /* callback(callback_arg, problem, event) on the events of the search */
+  /* (NULL: no report, see solver_ctx_set_callback()) */
+  solver_callback_t callback;
+  void *callback_arg;
+  /* the other settings of the search (lb_weight, lookahead_depth, ...) */
+  solver_option_t solver;
+} pmp_option_t;
+
+typedef struct {
+  /* True: solution is proven optimal */
+  uchar optimal;
+  /* False: no feasible solution is found */
+  uchar feasible;
+  int n_relocation;
+  int lb;
+  ulint n_node;
+  double time;
+} pmp_statistics_t;
+
+void pmp_default_option(pmp_option_t *);
+problem_t *pmp_create_problem(int, int, int *, int *);
+uchar pmp_solve(solver_ctx_t *, problem_t *, pmp_option_t *, solution_t *,
+                pmp_statistics_t *);
+
+#endif /* !PMP_H */
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "define.h"
+#include "presolve.h"
+#include "problem.h"
+#include "solution.h"
+
+/*
+ * presolve
+ * the lowest tiers are removed from all the stacks when they are clean
+ * and their blocks have priorities not smaller than any block above
+ * them.  such a floor never has to be relocated, and any block placed
+ * on it is well-placed, so the reduced problem with a lower stack
+ * height has the same optimal value.  the blocks are renumbered in the
+ * original order and their priorities are compressed again.
+ * NULL is returned when no tier can be removed.
+ *
+ */
+problem_t *presolve(problem_t *problem)
+{
+  int i, j, k, n_floor, n_block, priority;
+  int min_floor, max_rest;
+  int *no, *rank;
+  problem_t *reduced;
+
+  for(n_floor = 0; ; ++n_floor) {
+    /* can tier n_floor be added to the floor? */
+    min_floor = problem->max_priority;
+    max_rest = -1;
+    for(i = 0; i < problem->n_stack; ++i) {
+      if(problem->n_tier[i] <= n_floor
+         || (n_floor > 0 && problem->block[i][n_floor].priority
+             > problem->block[i][n_floor - 1].priority)) {
+        break;
+      }
+      min_floor = min(min_floor, problem->block[i][n_floor].priority);
+      for(j = n_floor + 1; j < problem->n_tier[i]; ++j) {
+        max_rest = max(max_rest, problem->block[i][j].priority);
+      }
+    }
+
+    if(i < problem->n_stack || max_rest < 0 || min_floor < max_rest) {
+      break;
+    }
+  }
+
+  if(n_floor == 0) {
+    return(NULL);
+  }
+
+  n_block = problem->n_block - n_floor*problem->n_stack;
+  reduced = create_problem(problem->n_stack, problem->s_height - n_floor,
+                           n_block);
+  reduced->stime = problem->stime;
+  reduced->time = problem->time;
+
+  reduced->block[0]
+    = (block_t *) calloc((size_t) reduced->n_stack*reduced->s_height,
+                         sizeof(block_t));
+  for(i = 1; i < reduced->n_stack; ++i) {
+    reduced->block[i] = reduced->block[i - 1] + reduced->s_height;
+  }
+
+  no = (int *) malloc((size_t) (problem->n_block + problem->max_priority + 1)
+                      *sizeof(int));
+  rank = no + problem->n_block;
+  for(i = 0; i < problem->n_block; ++i) {
+    no[i] = -1;
+  }
+  for(i = 0; i <= problem->max_priority; ++i) {
+    rank[i] = -1;
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    for(j = n_floor; j < problem->n_tier[i]; ++j) {
+      no[problem->block[i][j].no] = 0;
+      rank[problem->block[i][j].priority] = 0;
+    }
+  }
+
+  /* renumber the blocks and compress the priorities */
+  for(i = k = 0; i < problem->n_block; ++i) {
+    if(no[i] == 0) {
+      reduced->priority[k] = problem->priority[i];
+      no[i] = k++;
+    }
+  }
+  for(i = 0, priority = -1; i <= problem->max_priority; ++i) {
+    if(rank[i] == 0) {
+      rank[i] = ++priority;
+    }
+  }
+  reduced->max_priority = priority;
+  if(reduced->max_priority < reduced->n_block - 1) {
+    reduced->duplicate = True;
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    reduced->n_tier[i] = problem->n_tier[i] - n_floor;
+    for(j = 0; j < reduced->n_tier[i]; ++j) {
+      k = no[problem->block[i][j + n_floor].no];
+      reduced->block[i][j].no = k;
+      reduced->block[i][j].priority
+        = rank[problem->block[i][j + n_floor].priority];
+      reduced->position[k].s = i;
+      reduced->position[k].t = j;
+    }
+  }
+
+  free(no);
+
+  return(reduced);
+}
+
+/*
+ * map a solution of the reduced problem to the original one
+ *
+ */
+void postsolve(problem_t *problem, problem_t *reduced, solution_t *solution)
+{
+  int i, s, t;
+  int n_floor = problem->s_height - reduced->s_height;
+  block_t *block;
+
+  if(solution->n_relocation > MAX_N_RELOCATION) {
+    return;
+  }
+
+  for(i = 0; i < solution->n_relocation; ++i) {
+    block = &(solution->relocation[i].block);
+    s = reduced->position[block->no].s;
+    t = reduced->position[block->no].t;
+    *block = problem->block[s][t + n_floor];
+  }
+}
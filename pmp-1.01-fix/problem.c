@@ -37,6 +37,27 @@
 #include "define.h"
 #include "problem.h"
 
+uchar verbose = False;
+int tlimit = -1;
+int n_thread = 1;
+double grasp_time = 0.0;
+uchar pilot_method = False;
+int beam_width = 0;
+uchar lds_mode = False;
+int lns_window = 0;
+int lb_gap = 0;
+double lb_weight = 1.0;
+int n_speculation = 0;
+uchar hybrid_mode = False;
+int restart_unit = 0;
+int lookahead_depth = 0;
+uchar presolve_mode = False;
+int n_pdb = 0;
+char *pdb_dir = NULL;
+int endgame_threshold = 0;
+int flow_depth = 0;
+uchar wall_clock = False;
+
 problem_t *create_problem(int n_stack, int s_height, int n_block)
 {
   problem_t *problem = (problem_t *) calloc(1, sizeof(problem_t));
@@ -66,3 +87,39 @@ void free_problem(problem_t *problem)
     free(problem);
   }
 }
+
+/*
+ * copy of problem whose stack s is stack perm[s] of problem
+ *
+ */
+problem_t *permute_problem(problem_t *problem, int *perm)
+{
+  int i, j;
+  problem_t *pproblem = create_problem(problem->n_stack, problem->s_height,
+                                       problem->n_block);
+
+  pproblem->duplicate = problem->duplicate;
+  pproblem->max_priority = problem->max_priority;
+  pproblem->stime = problem->stime;
+  pproblem->time = problem->time;
+  memcpy((void *) pproblem->priority, (void *) problem->priority,
+         (size_t) problem->n_block*sizeof(int));
+
+  pproblem->block[0]
+    = (block_t *) calloc((size_t) problem->n_stack*problem->s_height,
+                         sizeof(block_t));
+  for(i = 1; i < problem->n_stack; ++i) {
+    pproblem->block[i] = pproblem->block[i - 1] + problem->s_height;
+  }
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    pproblem->n_tier[i] = problem->n_tier[perm[i]];
+    for(j = 0; j < problem->n_tier[perm[i]]; ++j) {
+      pproblem->block[i][j] = problem->block[perm[i]][j];
+      pproblem->position[pproblem->block[i][j].no].s = i;
+      pproblem->position[pproblem->block[i][j].no].t = j;
+    }
+  }
+
+  return(pproblem);
+}
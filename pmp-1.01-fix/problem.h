@@ -59,10 +59,29 @@ typedef struct {
   double time;
 } problem_t;
 
-uchar verbose;
-int tlimit;
+extern uchar verbose;
+extern int tlimit;
+extern int n_thread;
+extern double grasp_time;
+extern uchar pilot_method;
+extern int beam_width;
+extern uchar lds_mode;
+extern int lns_window;
+extern int lb_gap;
+extern double lb_weight;
+extern int n_speculation;
+extern uchar hybrid_mode;
+extern int restart_unit;
+extern int lookahead_depth;
+extern uchar presolve_mode;
+extern int n_pdb;
+extern char *pdb_dir;
+extern int endgame_threshold;
+extern int flow_depth;
+extern uchar wall_clock;
 
 problem_t *create_problem(int, int, int);
 void free_problem(problem_t *);
+problem_t *permute_problem(problem_t *, int *);
 
 #endif /* !PROBLEM_H */
@@ -0,0 +1,425 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "define.h"
+#include "batch.h"
+#include "input.h"
+#include "pmp.h"
+#include "problem.h"
+#include "serve.h"
+#include "solution.h"
+#include "solve.h"
+#include "timer.h"
+
+/* upper limit of the size of an instance in a request */
+#define SERVE_MAX_LENGTH (1<<24)
+
+typedef struct job_t {
+  int fd;
+  problem_t *problem;
+  solution_t *solution;
+  double tlimit;
+  int gap;
+  uchar ret;
+  uchar done;
+  struct job_t *next;
+} job_t;
+
+typedef struct {
+  /* arguments of read_file() */
+  int n_stack;
+  int s_height;
+  int n_empty_tier;
+  /* jobs waiting for a worker */
+  job_t *head, *tail;
+  pthread_mutex_t mutex;
+  /* a job is queued */
+  pthread_cond_t queued;
+  /* a job is done */
+  pthread_cond_t done;
+} server_t;
+
+typedef struct {
+  server_t *server;
+  int fd;
+} connection_t;
+
+static void *serve_worker(void *);
+static void *serve_connection(void *);
+static problem_t *serve_read(server_t *, FILE *, int, char *, int);
+static void serve_improved(void *, problem_t *, solver_event_t *);
+static void serve_result(job_t *, solver_ctx_t *);
+static int serve_relocation(char *, int, solution_t *);
+static void serve_write(int, char *);
+
+/*
+ * solver daemon on the unix domain socket path
+ * a request is a line
+ *   solve text|binary <length> [<time limit> [<gap>]]
+ * followed by the instance of length bytes in the text format or as
+ * the 32-bit little endian integers
+ *   n_stack s_height n_tier[0..n_stack-1] priorities
+ * (priorities stack by stack from the bottom tier).  the time limit
+ * in seconds counts from the receipt of the request (0: no limit).
+ * an improved solution is sent as
+ *   ub=<n> time=<t> <src>=><dst> ...
+ * and the result as
+ *   opt=<n>|best=<n>|none lb=<lb> nodes=<n> time=<t> <src>=><dst> ...
+ * or error <reason>.  stacks are numbered from 1.  requests on a
+ * connection are processed one by one, by n_thread workers in total
+ * whose working areas are kept between the requests.
+ *
+ */
+int serve(char *path, int n_stack, int s_height, int n_empty_tier)
+{
+  int i;
+  int n_worker, sock, fd;
+  server_t server;
+  struct sockaddr_un addr;
+  pthread_t thread;
+  pthread_attr_t attr;
+
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return(1);
+  }
+
+  memset((void *) &addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    perror("socket");
+    return(1);
+  }
+  unlink(path);
+  if(bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0
+     || listen(sock, SOMAXCONN) < 0) {
+    perror(path);
+    close(sock);
+    return(1);
+  }
+
+  /* a client may close the connection before its results are sent */
+  signal(SIGPIPE, SIG_IGN);
+
+  server.n_stack = n_stack;
+  server.s_height = s_height;
+  server.n_empty_tier = n_empty_tier;
+  server.head = server.tail = NULL;
+  pthread_mutex_init(&(server.mutex), NULL);
+  pthread_cond_init(&(server.queued), NULL);
+  pthread_cond_init(&(server.done), NULL);
+
+  n_worker = setup_workers();
+  /* the time limits are deadlines of the requests */
+  wall_clock = True;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  for(i = 0; i < n_worker; ++i) {
+    pthread_create(&thread, &attr, serve_worker, (void *) &server);
+  }
+
+  fprintf(stderr, "serving on %s with %d workers\n", path, n_worker);
+
+  while(True) {
+    connection_t *connection;
+
+    if((fd = accept(sock, NULL, NULL)) < 0) {
+      if(errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      perror("accept");
+      break;
+    }
+
+    connection = (connection_t *) malloc(sizeof(connection_t));
+    connection->server = &server;
+    connection->fd = fd;
+    pthread_create(&thread, &attr, serve_connection, (void *) connection);
+  }
+
+  close(sock);
+  unlink(path);
+
+  return(1);
+}
+
+void *serve_worker(void *arg)
+{
+  server_t *server = (server_t *) arg;
+  solver_ctx_t *ctx = create_solver_ctx();
+  job_t *job;
+
+  if(server->n_stack > 0 && server->s_height > 0) {
+    /* the working area for problems up to -S and -T */
+    reserve_solver_ctx(ctx, server->n_stack, server->s_height,
+                       server->n_stack*server->s_height);
+  }
+
+  while(True) {
+    pthread_mutex_lock(&(server->mutex));
+    while(server->head == NULL) {
+      pthread_cond_wait(&(server->queued), &(server->mutex));
+    }
+    job = server->head;
+    if((server->head = job->next) == NULL) {
+      server->tail = NULL;
+    }
+    pthread_mutex_unlock(&(server->mutex));
+
+    solver_ctx_set_limit(ctx, job->tlimit, job->gap);
+    solver_ctx_set_callback(ctx, serve_improved, (void *) job);
+    job->ret = solve_ctx(ctx, job->problem, job->solution);
+    serve_result(job, ctx);
+
+    pthread_mutex_lock(&(server->mutex));
+    job->done = True;
+    pthread_cond_broadcast(&(server->done));
+    pthread_mutex_unlock(&(server->mutex));
+  }
+
+  return(NULL);
+}
+
+void *serve_connection(void *arg)
+{
+  connection_t *connection = (connection_t *) arg;
+  server_t *server = connection->server;
+  int fd = connection->fd;
+  int length, gap, n;
+  double tlimit;
+  char buf[MAXBUFLEN], format[16];
+  FILE *fp;
+  job_t job;
+
+  free(connection);
+
+  if((fp = fdopen(fd, "r")) == NULL) {
+    close(fd);
+    return(NULL);
+  }
+
+  while(fgets(buf, MAXBUFLEN, fp) != NULL) {
+    tlimit = 0.0;
+    gap = 0;
+    n = sscanf(buf, "solve %15s %d %lf %d", format, &length, &tlimit, &gap);
+    if(n < 2 || length <= 0 || length > SERVE_MAX_LENGTH) {
+      serve_write(fd, "error invalid request\n");
+      break;
+    }
+
+    if((job.problem = serve_read(server, fp, length, format, fd)) == NULL) {
+      continue;
+    }
+
+    /* the time limit counts from here */
+    timer_start(job.problem);
+
+    job.fd = fd;
+    job.solution = create_solution();
+    job.tlimit = tlimit;
+    job.gap = gap;
+    job.done = False;
+    job.next = NULL;
+
+    pthread_mutex_lock(&(server->mutex));
+    if(server->tail == NULL) {
+      server->head = &job;
+    } else {
+      server->tail->next = &job;
+    }
+    server->tail = &job;
+    pthread_cond_signal(&(server->queued));
+    while(job.done == False) {
+      pthread_cond_wait(&(server->done), &(server->mutex));
+    }
+    pthread_mutex_unlock(&(server->mutex));
+
+    free_solution(job.solution);
+    free_problem(job.problem);
+  }
+
+  fclose(fp);
+
+  return(NULL);
+}
+
+/*
+ * read an instance of length bytes in format from fp
+ * an error is sent to fd on failure.
+ *
+ */
+problem_t *serve_read(server_t *server, FILE *fp, int length, char *format,
+                      int fd)
+{
+  int i;
+  int n_stack, s_height, n_block, n;
+  uchar *data = (uchar *) malloc((size_t) length);
+  int *value;
+  problem_t *problem = NULL;
+
+  if(fread((void *) data, 1, (size_t) length, fp) != (size_t) length) {
+    free(data);
+    serve_write(fd, "error incomplete instance\n");
+    return(NULL);
+  }
+
+  if(strcmp(format, "text") == 0) {
+    FILE *mfp;
+
+    if((mfp = fmemopen((void *) data, (size_t) length, "r")) != NULL) {
+      problem = read_problem(mfp, server->n_stack, server->s_height,
+                             server->n_empty_tier);
+      fclose(mfp);
+    }
+  } else if(strcmp(format, "binary") == 0 && length%4 == 0) {
+    n = length/4;
+    value = (int *) malloc((size_t) n*sizeof(int));
+    for(i = 0; i < n; ++i) {
+      value[i] = (int) ((uint) data[4*i] | (uint) data[4*i + 1]<<8
+                        | (uint) data[4*i + 2]<<16
+                        | (uint) data[4*i + 3]<<24);
+    }
+
+    if(n >= 2 && value[0] > 0 && value[0] <= n - 2) {
+      n_stack = value[0];
+      s_height = value[1];
+      for(i = 0, n_block = 0; i < n_stack && n_block <= n; ++i) {
+        n_block += min(max(0, value[2 + i]), n);
+      }
+      if(n == 2 + n_stack + n_block) {
+        problem = pmp_create_problem(n_stack, s_height, value + 2,
+                                     value + 2 + n_stack);
+      }
+    }
+    free(value);
+  }
+
+  free(data);
+
+  if(problem == NULL) {
+    serve_write(fd, "error invalid instance\n");
+  }
+
+  return(problem);
+}
+
+void serve_improved(void *arg, problem_t *problem, solver_event_t *event)
+{
+  job_t *job = (job_t *) arg;
+  solution_t *solution = event->solution;
+  char buf[MAXBUFLEN];
+  int n;
+
+  /* only the improvements of solution are sent to the client */
+  if(event->type != SOLUTION_EVENT) {
+    return;
+  }
+
+  n = snprintf(buf, MAXBUFLEN, "ub=%d time=%.3f", solution->n_relocation,
+               get_time(problem));
+  serve_relocation(buf + n, MAXBUFLEN - n, solution);
+  serve_write(job->fd, buf);
+}
+
+void serve_result(job_t *job, solver_ctx_t *ctx)
+{
+  char buf[MAXBUFLEN];
+  int n;
+
+  set_time(job->problem);
+  if(job->solution->n_relocation > MAX_N_RELOCATION) {
+    n = snprintf(buf, MAXBUFLEN, "none");
+  } else {
+    n = snprintf(buf, MAXBUFLEN, "%s=%d", (job->ret == True)?"opt":"best",
+                 job->solution->n_relocation);
+  }
+  n += snprintf(buf + n, MAXBUFLEN - n, " lb=%d nodes=%llu time=%.3f",
+                solver_ctx_lower_bound(ctx), solver_ctx_nodes(ctx),
+                job->problem->time);
+  if(job->solution->n_relocation <= MAX_N_RELOCATION) {
+    serve_relocation(buf + n, MAXBUFLEN - n, job->solution);
+  } else {
+    snprintf(buf + n, MAXBUFLEN - n, "\n");
+  }
+  serve_write(job->fd, buf);
+}
+
+/*
+ * the relocations of solution and a newline are written to buf
+ *
+ */
+int serve_relocation(char *buf, int size, solution_t *solution)
+{
+  int i;
+  int n = 0;
+
+  for(i = 0; i < solution->n_relocation && n < size - 16; ++i) {
+    n += snprintf(buf + n, size - n, " %d=>%d",
+                  solution->relocation[i].src + 1,
+                  solution->relocation[i].dst + 1);
+  }
+  n += snprintf(buf + n, size - n, "\n");
+
+  return(n);
+}
+
+void serve_write(int fd, char *buf)
+{
+  ssize_t n;
+  size_t length = strlen(buf);
+
+  while(length > 0) {
+    if((n = write(fd, buf, length)) < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      /* the client has gone */
+      return;
+    }
+    buf += n;
+    length -= (size_t) n;
+  }
+}
@@ -61,8 +61,10 @@ void copy_solution(solution_t *dst, solution_t *src)
                                    *sizeof(relocation_t));
     }
     dst->n_relocation = src->n_relocation;
-    memcpy((void *) dst->relocation, (void *) src->relocation,
-           (size_t) src->n_relocation*sizeof(relocation_t));
+    if(src->n_relocation > 0) {
+      memcpy((void *) dst->relocation, (void *) src->relocation,
+             (size_t) src->n_relocation*sizeof(relocation_t));
+    }
   }
 }
 
@@ -115,13 +117,49 @@ state_t *create_state(problem_t *problem)
   return(state);
 }
 
+/*
+ * the number of integers pointed by demand, supply, removal_for_supply
+ * (and removal_histogram), which are allocated in a single area
+ *
+ */
+int lb_state_size(problem_t *problem)
+{
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+  return((problem->max_priority + 1)
+         *(problem->n_stack + 2 + problem->s_height + 1));
+#else /* !IMPROVED_BF_LOWER_BOUND_BY_ALL */
+  return((problem->max_priority + 1)*(problem->n_stack + 2));
+#endif /* !IMPROVED_BF_LOWER_BOUND_BY_ALL */
+}
+
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+/*
+ * add (delta = 1) or remove (delta = -1) a stack in the histograms of
+ * removal_for_supply
+ *
+ */
+static void update_removal_histogram(problem_t *problem, lb_state_t *lb_state,
+                                     int clean_priority,
+                                     int *removal_for_supply, int delta)
+{
+  int i;
+  int *histogram = lb_state->removal_histogram
+    + (clean_priority + 1)*(problem->s_height + 1);
+
+  for(i = clean_priority + 1; i <= problem->max_priority;
+      ++i, histogram += problem->s_height + 1) {
+    histogram[removal_for_supply[i]] += delta;
+  }
+}
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
+
 lb_state_t *create_lb_state(problem_t *problem)
 {
   int i;
   lb_state_t *lb_state = (lb_state_t *) calloc(sizeof(lb_state_t), 1);
   
-  lb_state->demand = (int *) calloc((size_t) (problem->max_priority + 1)
-                                    *(problem->n_stack + 2), sizeof(int));
+  lb_state->demand
+    = (int *) calloc((size_t) lb_state_size(problem), sizeof(int));
   lb_state->supply = lb_state->demand + (problem->max_priority + 1);
 
   lb_state->removal_for_supply
@@ -133,6 +171,11 @@ lb_state_t *create_lb_state(problem_t *problem)
     lb_state->removal_for_supply[i]
       = lb_state->removal_for_supply[i - 1] + (problem->max_priority + 1);
   }
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+  lb_state->removal_histogram
+    = lb_state->removal_for_supply[0]
+    + problem->n_stack*(problem->max_priority + 1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
 
   return(lb_state);
 }
@@ -201,7 +244,7 @@ lb_state_t *initialize_lb_state(problem_t *problem, state_t *state,
   nlb_state->n_dirty_stack = nlb_state->n_full_clean_stack = 0;
 
   memset((void *) nlb_state->demand, 0,
-         (problem->max_priority + 1)*(problem->n_stack + 2)*sizeof(int));
+         (size_t) lb_state_size(problem)*sizeof(int));
 
   for(i = 0; i < problem->n_stack; ++i) {
     int priority, count = 0;
@@ -231,6 +274,10 @@ lb_state_t *initialize_lb_state(problem_t *problem, state_t *state,
     for(; priority <= problem->max_priority; ++priority) {
       removal_for_supply[priority] = count;
     }
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+    update_removal_histogram(problem, nlb_state, stack->clean_priority,
+                             removal_for_supply, 1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
   }
 
   return(nlb_state);
@@ -261,8 +308,7 @@ void copy_lb_state(problem_t *problem, lb_state_t *dst, lb_state_t *src)
   dst->n_full_clean_stack = src->n_full_clean_stack;
 
   memcpy((void *) dst->demand, (void *) src->demand,
-         (size_t) (problem->max_priority + 1)*(problem->n_stack + 2)
-         *sizeof(int));
+         (size_t) lb_state_size(problem)*sizeof(int));
 }
 
 state_t *duplicate_state(problem_t *problem, state_t *state)
@@ -367,6 +413,10 @@ uchar update_state_src(problem_t *problem, state_t *state,
 
   if(stack->n_clean > stack->n_tier) {
     /* GX relocation */
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+    update_removal_histogram(problem, lb_state, stack->clean_priority,
+                             removal_for_supply, -1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
 
     if(stack->n_tier == 0) {
       /* no block is left */
@@ -391,6 +441,10 @@ uchar update_state_src(problem_t *problem, state_t *state,
     for(; i <= problem->max_priority; ++i) {
       --removal_for_supply[i];
     }
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+    update_removal_histogram(problem, lb_state, stack->clean_priority,
+                             removal_for_supply, 1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
 
     return(False);
   }
@@ -431,6 +485,10 @@ uchar update_state_dst(problem_t *problem, state_t *state,
 
     if(block->priority <= stack->clean_priority) {
       /* XG relocation */
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+      update_removal_histogram(problem, lb_state, stack->clean_priority,
+                               removal_for_supply, -1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
 
       if(stack->n_tier == problem->s_height - 1) {
         ++lb_state->n_full_clean_stack;
@@ -459,6 +517,10 @@ uchar update_state_dst(problem_t *problem, state_t *state,
       /* supply increases */
       lb_state->supply[stack->clean_priority]
         += problem->s_height - stack->n_tier;
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+      update_removal_histogram(problem, lb_state, stack->clean_priority,
+                               removal_for_supply, 1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
 
       return(False);
     }
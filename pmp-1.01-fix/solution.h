@@ -36,6 +36,10 @@
 #include "define.h"
 #include "problem.h"
 
+/* improvement of nGX by checking demand surplus for every priority */
+/* (the numbers of stacks by removal_for_supply are kept in lb_state_t) */
+#undef IMPROVED_BF_LOWER_BOUND_BY_ALL
+
 typedef struct {
   int src;
   int dst;
@@ -83,6 +87,11 @@ typedef struct {
   int *demand;
   int *supply;
   int **removal_for_supply;
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+  /* removal_histogram[priority*(s_height + 1) + n]: the number of stacks */
+  /* with clean priority < priority and removal_for_supply = n */
+  int *removal_histogram;
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
 } lb_state_t;
 
 
@@ -92,6 +101,7 @@ void copy_solution(solution_t *, solution_t *);
 void add_relocation(solution_t *, int, int, block_t *);
 state_t *create_state(problem_t *);
 lb_state_t *lb_create_state(problem_t *);
+int lb_state_size(problem_t *);
 state_t *initialize_state(problem_t *, state_t *);
 lb_state_t *initialize_lb_state(problem_t *, state_t *, lb_state_t *);
 void copy_state(problem_t *, state_t *, state_t *);
@@ -34,8 +34,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "define.h"
+#include "endgame.h"
+#include "flow.h"
+#include "grasp.h"
 #include "heuristics.h"
+#include "pdb.h"
+#include "pilot.h"
 #include "print.h"
 #include "problem.h"
 #include "solution.h"
@@ -59,14 +65,29 @@
 #undef IMPROVED_BF_LOWER_BOUND3
 
 /* improvement of nGX by DP */
-#undef IMPROVED_BF_LOWER_BOUND_BY_DP
+#define IMPROVED_BF_LOWER_BOUND_BY_DP
 
-/* improvement of nGX by checking demand surplus for every priority */
-#undef IMPROVED_BF_LOWER_BOUND_BY_ALL
+/* IMPROVED_BF_LOWER_BOUND_BY_ALL is defined in solution.h */
 
-/* second lower bound */
+/* second lower bound (not admissible: it cuts off optimal paths, e.g. */
+/* the 11 relocations of example3.txt in iteration ub=11) */
 #undef LOWER_BOUND2
 
+/* the bounds escalated at the threshold (lower_bound2() and */
+/* flow_lower_bound()) are skipped in the depth bands where they rarely */
+/* cut off nodes */
+#define ADAPTIVE_LOWER_BOUND
+
+#ifdef ADAPTIVE_LOWER_BOUND
+#define SELECT_LOWER_BOUND(ctx, bound, level) \
+  select_lower_bound(ctx, bound, level)
+#define RECORD_LOWER_BOUND(ctx, bound, level, cutoff) \
+  record_lower_bound(ctx, bound, level, cutoff)
+#else /* !ADAPTIVE_LOWER_BOUND */
+#define SELECT_LOWER_BOUND(ctx, bound, level) (True)
+#define RECORD_LOWER_BOUND(ctx, bound, level, cutoff)
+#endif /* !ADAPTIVE_LOWER_BOUND */
+
 /* type of the dominance check for independent relocations */
 /* jinbo: use the second type */
 // #define TYPE1
@@ -74,7 +95,20 @@
 /* depth first, ties are broken by best first (smaller lower bound first) */
 #define BEST_FIRST
 
-static ulint n_node, count;
+/* lower bound inflated by lb_weight of ctx (weighted IDA*) */
+#define WEIGHTED_LB(ctx, lb) (((ctx)->option.lb_weight > 1.0)        \
+                              ?(int) ((ctx)->option.lb_weight*(lb)):(lb))
+
+/* hybrid mode: switch to depth-first b&b when the iterations left are */
+/* expected to take HYBRID_RATIO times as many nodes as a single pass */
+#define HYBRID_RATIO (2.0)
+
+/* a run of randomized restarts is at least RESTART_MIN_UNIT nodes long */
+#define RESTART_MIN_UNIT (4096)
+
+/* the time limit and the other searches are checked at every */
+/* CHECK_INTERVAL nodes */
+#define CHECK_INTERVAL (4096)
 
 typedef struct {
   int index;
@@ -88,164 +122,430 @@ typedef struct {
 #endif
 } child_node_t;
 
-static child_node_t **child_node;
+/* a node on the path of the iterative search */
+typedef struct {
+  /* lower bound state of the node */
+  lb_state_t *lb_state;
+  /* the number of child nodes other than the first one allowed on */
+  /* the path below the node (negative: unlimited) */
+  int discrepancy;
+  /* the child nodes are generated */
+  uchar expanded;
+  int n_child;
+  /* the number of child nodes entered (those cut off by the bound are */
+  /* not counted as discrepancies) */
+  int n_searched;
+  /* the child nodes next, ..., end - 1 are left to be searched */
+  /* (those from end on are handed off to another search) */
+  int next;
+  int end;
+  int n_misoverlay;
+  /* the relocation to the child node being searched, and the state */
+  /* it has changed */
+  int src;
+  int dst;
+  block_t reloc_block;
+  stack_state_t src_stack;
+  stack_state_t dst_stack;
+  block_state_t block_state_backup;
+  int last_change;
+} search_node_t;
+
+/* header of a saved iteration, followed by the statistics of the */
+/* adaptive lower bounds and the nodes on the path */
+typedef struct {
+  char magic[8];
+  int n_stack;
+  int s_height;
+  int n_block;
+  int max_priority;
+  int depth;
+  int ub;
+  int stop_ub;
+  /* size of the statistics (0: not adaptive) */
+  int statistics_size;
+} search_header_t;
+
+#define SEARCH_MAGIC "PMPSRCH"
+
+/* working area for lower_bound() (also used by beam search) */
+struct lb_work {
+  int *table;
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_DP
+  ulint *bits;
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_DP */
+  /* pattern databases (NULL: not used) */
+  pdb_t *pdb;
+};
+
+#ifdef LOWER_BOUND2
+/* terms of lower_bound2() for the pairs of stacks other than the */
+/* destination, shared among the destinations of a source stack */
+typedef struct {
+  uchar valid;
+  uchar all_dirty;
+  int max_clean_priority;
+  int extra_relocation;
+  uchar *computed;
+  int *relocation;
+} lb2_cache_t;
+#endif /* LOWER_BOUND2 */
+
+#ifdef ADAPTIVE_LOWER_BOUND
+enum { SECOND_BOUND, FLOW_BOUND, N_ADAPTIVE_BOUND };
 
-static state_t *state;
-static lb_state_t **lb_state;
-static stack_state_t **stack_state;
-static solution_t *partial_solution;
-static int *lb_work;
-static int *last_change_bw, *last_change_empty_bw, *dominance_check;
-static int **last_priority_level;
+/* the statistics are taken for each band of LB_BAND_WIDTH levels */
+#define LB_N_BAND (8)
+#define LB_BAND_WIDTH (4)
+/* a bound is always evaluated for the first LB_WARMUP nodes of a band, */
+/* and then for one of LB_PROBE nodes even if it is not profitable */
+#define LB_WARMUP (256)
+#define LB_PROBE (16)
+/* the statistics are halved after LB_WINDOW evaluations */
+#define LB_WINDOW (4096)
+
+typedef struct {
+  uint n_evaluation;
+  uint n_cutoff;
+  uint n_skip;
+} lb_statistics_t;
+
+/* a bound is profitable if it cuts off one of lb_cost[] evaluations */
+/* (the cost of an evaluation relative to the nodes saved by a cutoff) */
+static const uint lb_cost[N_ADAPTIVE_BOUND] = { 32, 8 };
+#endif /* ADAPTIVE_LOWER_BOUND */
 #ifdef TYPE1
 static int dominance_table[4][4] =
   { { 0, 1, 0, 0 },
     { 1, 1, 2, 1 },
     { 0, 2, 0, 0 },
     { 0, 1, 0, 0 } };
-struct {
-  int src;
-  int dst;
-} preloc[3];
 #endif /* TYPE1 */
 
+/* iterations ub=lb, lb+1, ... shared by the threads of speculative search */
+typedef struct {
+  problem_t *problem;
+  solution_t *solution;
+  /* size of the shared incumbent */
+  volatile int best;
+  /* the iterations from cutoff on are unnecessary */
+  volatile int cutoff;
+  /* depth of probing (0: complete iterations) */
+  int depth;
+  /* next iteration to be started */
+  int next_ub;
+  /* all the iterations below proven_lb have failed */
+  volatile int proven_lb;
+  /* failed[ub]: iteration ub has failed */
+  uchar *failed;
+  uchar time_limit;
+  /* time limit and gap of the searches */
+  double tlimit;
+  int gap;
+  /* the search whose events are reported */
+  solver_ctx_t *ctx;
+  ulint n_node;
+  pthread_mutex_t mutex;
+} speculation_t;
+
+/* a run of randomized restarts on a permutation of the stacks */
+typedef struct {
+  problem_t *problem;
+  /* solution on problem reported to callback */
+  solution_t *solution;
+  /* size of the last solution reported */
+  int best;
+  /* stack perm[s] of problem is stack s of the permuted problem */
+  int *perm;
+  solver_callback_t callback;
+  void *callback_arg;
+} restart_t;
+
+/* working area and state of a search */
+struct solver_ctx {
+  ulint n_node, count;
+  /* time limit of the search (0: no limit) */
+  double tlimit;
+  /* the search stops when the gap is at most gap */
+  int gap;
+  /* number of threads of the parallel heuristics and the lookahead */
+  int n_thread;
+  /* the other settings of the search */
+  solver_option_t option;
+  /* working areas of the search for its problem (NULL: not used) */
+  lb_work_t *lb_work;
+  heuristics_work_t *heuristics_work;
+  endgame_t *endgame;
+  flow_t *flow;
+  /* pattern databases, built by the search unless they are shared */
+  /* by the search running it (own_pdb = False) */
+  pdb_t *pdb;
+  uchar own_pdb;
+  /* lower bound proven by the search */
+  int lb;
+  /* called on the events of the search */
+  solver_callback_t callback;
+  void *callback_arg;
+  /* NULL unless the search runs an iteration of speculative search */
+  speculation_t *speculation;
+  /* some child nodes are not searched due to the discrepancy limit */
+  uchar lds_cut;
+  /* the search is interrupted when n_node reaches node_limit (0: no limit) */
+  ulint node_limit;
+  /* path[1], ..., path[depth] of the iterative search (depth = 0: */
+  /* not in progress).  path[depth] is to be expanded or has no child */
+  /* node being searched, and the others search their child node next - 1 */
+  search_node_t *path;
+  int depth;
+  /* bound of the iteration run by run_iteration() */
+  int ub;
+#ifndef PURE_BRANCH_AND_BOUND
+  /* the current iteration terminates when an incumbent of this size */
+  /* is found */
+  int stop_ub;
+  /* the bound follows the incumbent instead of terminating the search */
+  uchar dfbnb_mode;
+  /* probing: the search is interrupted at a node of this depth */
+  /* (0: no limit) */
+  int depth_limit;
+  uchar depth_reached;
+#endif /* !PURE_BRANCH_AND_BOUND */
+
+  /* size of the problem for which the working area is laid out */
+  /* (n_stack = 0: not laid out, cap_n_stack = 0: not allocated) */
+  int n_stack;
+  int s_height;
+  int n_block;
+  int max_priority;
+  /* the working area is reused for a problem with at most cap_n_stack */
+  /* stacks, cap_max_priority + 1 priorities and lb states of cap_size */
+  int cap_n_stack;
+  int cap_size;
+  int cap_max_priority;
+
+  child_node_t **child_node;
+  state_t *state;
+  lb_state_t **lb_state;
+  stack_state_t **stack_state;
+  solution_t *partial_solution;
+  int *last_change_bw, *last_change_empty_bw;
+  int *dominance_check;
+  int **last_priority_level;
+#ifdef TYPE1
+  struct {
+    int src;
+    int dst;
+  } preloc[3];
+#endif /* TYPE1 */
+
+#ifdef LOWER_BOUND2
+  lb2_cache_t *lb2_cache;
+  /* lower_bound2() is evaluated n_lb2 times and cuts off n_lb2_cut nodes */
+  ulint n_lb2, n_lb2_cut;
+#endif /* LOWER_BOUND2 */
+#ifdef ADAPTIVE_LOWER_BOUND
+  lb_statistics_t lb_statistics[N_ADAPTIVE_BOUND][LB_N_BAND];
+  ulint n_lb_skip[N_ADAPTIVE_BOUND];
+#endif /* ADAPTIVE_LOWER_BOUND */
+};
+
 #ifdef PURE_BRANCH_AND_BOUND
-static uchar bb(problem_t *, solution_t *, lb_state_t *, int);
-static uchar bb_sub(problem_t *, solution_t *, lb_state_t *, int, int *);
+static uchar bb(solver_ctx_t *, problem_t *, solution_t *, lb_state_t *, int);
+static uchar search(solver_ctx_t *, problem_t *, solution_t *);
+static uchar bb_sub(solver_ctx_t *, problem_t *, solution_t *, lb_state_t *,
+                    int, int *);
 #else /* !PURE_BRANCH_AND_BOUND */
-static uchar bb(problem_t *, solution_t *, int *, lb_state_t *, int);
-static uchar bb_sub(problem_t *, solution_t *, int *, lb_state_t *, int, int *);
+static uchar bb(solver_ctx_t *, problem_t *, solution_t *, int *,
+                lb_state_t *, int);
+static uchar search(solver_ctx_t *, problem_t *, solution_t *, int *);
+static uchar bb_sub(solver_ctx_t *, problem_t *, solution_t *, int *,
+                    lb_state_t *, int, int *);
+static uchar lds(solver_ctx_t *, problem_t *, solution_t *, lb_state_t *);
+static uchar switch_to_dfbnb(int, double);
+static uchar dfbnb(solver_ctx_t *, problem_t *, solution_t *, lb_state_t *,
+                   int *);
+static uchar restart(solver_ctx_t *, problem_t *, solution_t *, lb_state_t *,
+                     int *);
+static int luby(int);
+static uchar speculate(solver_ctx_t *, problem_t *, solution_t *, int, int *,
+                       int, int);
+static void *speculation_worker(void *);
+static void share_solution(void *, problem_t *, solver_event_t *);
+static void restart_solution(void *, problem_t *, solver_event_t *);
+#endif /* !PURE_BRANCH_AND_BOUND */
+static void enter_child(solver_ctx_t *, int);
+static void leave_child(solver_ctx_t *, int);
+static void copy_node(solver_ctx_t *, problem_t *, solver_ctx_t *, int);
+static uchar write_node(solver_ctx_t *, problem_t *, int, FILE *);
+static uchar read_node(solver_ctx_t *, problem_t *, int, FILE *);
+static lb_state_t *create_search(solver_ctx_t *, problem_t *);
+static void free_search(solver_ctx_t *);
+static void report_solution(solver_ctx_t *, problem_t *, solution_t *,
+                            char *);
+#ifndef PURE_BRANCH_AND_BOUND
+static void report_iteration(solver_ctx_t *, problem_t *, int, int);
 #endif /* !PURE_BRANCH_AND_BOUND */
-static int lower_bound(problem_t *, state_t *, lb_state_t *, int, uchar);
+static void report_bound(solver_ctx_t *, problem_t *, int);
+static void reserve_search(solver_ctx_t *, int, int, int);
+static void allocate_search(solver_ctx_t *, problem_t *);
+static void release_search(solver_ctx_t *);
 #ifdef LOWER_BOUND2
-static int lower_bound2(problem_t *, state_t *, lb_state_t *);
+static int lower_bound2(problem_t *, state_t *, lb_state_t *, lb2_cache_t *,
+                        int);
+static int lower_bound2_pair(problem_t *, state_t *, lb_state_t *, int, int,
+                             int, uchar);
 #endif /* LOWER_BOUND2 */
+#ifdef ADAPTIVE_LOWER_BOUND
+static uchar select_lower_bound(solver_ctx_t *, int, int);
+static void record_lower_bound(solver_ctx_t *, int, int, uchar);
+#endif /* ADAPTIVE_LOWER_BOUND */
 
-uchar solve(problem_t *problem, solution_t *solution)
+solver_ctx_t *create_solver_ctx(void)
 {
-  int i, j, k;
-#ifndef PURE_BRANCH_AND_BOUND
-  int ub;
-#endif /* !PURE_BRANCH_AND_BOUND */
-  int n_relocation = MAX_N_RELOCATION + 1;
-  int max_n_child = problem->n_stack*(problem->n_stack - 1) + 1;
-  int size = (problem->max_priority + 1)*(problem->n_stack + 2);
-  uchar ret;
-  lb_state_t *clb_state;
+  solver_ctx_t *ctx = (solver_ctx_t *) calloc(sizeof(solver_ctx_t), 1);
 
-  state = initialize_state(problem, NULL);
+  ctx->tlimit = (double) max(0, tlimit);
+  ctx->gap = lb_gap;
+  ctx->n_thread = max(1, n_thread);
+  solver_default_option(&(ctx->option));
 
-  if(state->n_misoverlay == 0) {
-    fprintf(stderr, "No relocation necessary.\n");
-    free_state(state);
-    solution->n_relocation = 0;
-    return(True);
+  return(ctx);
+}
+
+void free_solver_ctx(solver_ctx_t *ctx)
+{
+  if(ctx != NULL) {
+    release_search(ctx);
+    free(ctx);
   }
+}
 
-  /* memory allocation */
+ulint solver_ctx_nodes(solver_ctx_t *ctx)
+{
+  return(ctx->n_node);
+}
 
-  /* working area for LB computation */
-#ifdef IMPROVED_BF_LOWER_BOUND_BY_DP
-  lb_work
-    = (int *) malloc((problem->s_height*problem->n_stack + 1)*sizeof(int));
-#else /* !IMPROVED_BF_LOWER_BOUND_BY_DP */
-  lb_work = (int *) malloc((problem->s_height + 1)*sizeof(int));
-#endif /* !IMPROVED_BF_LOWER_BOUND_BY_DP */
+int solver_ctx_lower_bound(solver_ctx_t *ctx)
+{
+  return(ctx->lb);
+}
 
-  /* state for LB computation */
-  lb_state = (lb_state_t **) malloc(n_relocation*sizeof(lb_state_t *));
+void solver_ctx_set_limit(solver_ctx_t *ctx, double tlimit, int gap)
+{
+  ctx->tlimit = max(0.0, tlimit);
+  ctx->gap = max(0, gap);
+}
 
-  lb_state[0] = (lb_state_t *) malloc(n_relocation*(max_n_child + 1)
-                                      *sizeof(lb_state_t));
-  lb_state[0][0].demand
-    = (int *) calloc((size_t) n_relocation*(max_n_child + 1)*size,
-                     sizeof(int));
-  lb_state[0][0].removal_for_supply
-    = (int **) malloc((size_t) n_relocation*(max_n_child + 1)
-                      *problem->n_stack*sizeof(int *));
+void solver_ctx_set_threads(solver_ctx_t *ctx, int n_thread)
+{
+  ctx->n_thread = max(1, n_thread);
+}
 
-  for(i = 0; i < n_relocation; ++i) {
-    if(i > 0) {
-      lb_state[i] = lb_state[i - 1] + (max_n_child + 1);
+void solver_default_option(solver_option_t *option)
+{
+  option->verbose = verbose;
+  option->grasp_time = grasp_time;
+  option->pilot_method = pilot_method;
+  option->lds_mode = lds_mode;
+  option->lb_weight = lb_weight;
+  option->n_speculation = n_speculation;
+  option->hybrid_mode = hybrid_mode;
+  option->restart_unit = restart_unit;
+  option->lookahead_depth = lookahead_depth;
+  option->endgame_threshold = endgame_threshold;
+  option->flow_depth = flow_depth;
+  option->n_pdb = n_pdb;
+  option->pdb_dir = pdb_dir;
+}
 
-      lb_state[i][0].demand
-        = lb_state[i - 1][0].demand + (max_n_child + 1)*size;
-      lb_state[i][0].removal_for_supply
-        = lb_state[i - 1][0].removal_for_supply
-        + (max_n_child + 1)*problem->n_stack;
-    }      
+void solver_ctx_set_option(solver_ctx_t *ctx, solver_option_t *option)
+{
+  ctx->option = *option;
+  ctx->option.lb_weight = max(1.0, option->lb_weight);
+}
 
-    lb_state[i][0].supply
-      = lb_state[i][0].demand + (problem->max_priority + 1);
-    lb_state[i][0].removal_for_supply[0]
-      = lb_state[i][0].supply + (problem->max_priority + 1);
-    for(k = 1; k < problem->n_stack; ++k) {
-      lb_state[i][0].removal_for_supply[k]
-      = lb_state[i][0].removal_for_supply[k - 1] + (problem->max_priority + 1);
-    }
-    
-    for(j = 1; j < max_n_child + 1; ++j) {
-      lb_state[i][j].demand = lb_state[i][j - 1].demand + size;
-      lb_state[i][j].supply = lb_state[i][j - 1].supply + size;
-      lb_state[i][j].removal_for_supply
-        = lb_state[i][j - 1].removal_for_supply + problem->n_stack;
-      for(k = 0; k < problem->n_stack; ++k) {
-        lb_state[i][j].removal_for_supply[k]
-        = lb_state[i][j - 1].removal_for_supply[k] + size;
-      }
-    }
+/*
+ * callback(arg, problem, event) is called on the events of the searches
+ * on ctx as they happen (NULL: no report).  it is called by one thread
+ * at a time, but not always by the one running solve_ctx().
+ *
+ */
+void solver_ctx_set_callback(solver_ctx_t *ctx, solver_callback_t callback,
+                             void *arg)
+{
+  ctx->callback = callback;
+  ctx->callback_arg = arg;
+}
+
+/*
+ * reserve the working area for problems of up to the given size
+ * so that the first search does not allocate it
+ *
+ */
+void reserve_solver_ctx(solver_ctx_t *ctx, int n_stack, int s_height,
+                        int n_block)
+{
+  problem_t *problem = create_problem(n_stack, s_height, n_block);
+
+  problem->max_priority = n_block - 1;
+  if(n_stack > ctx->cap_n_stack || lb_state_size(problem) > ctx->cap_size
+     || problem->max_priority > ctx->cap_max_priority) {
+    release_search(ctx);
+    reserve_search(ctx, n_stack, lb_state_size(problem),
+                   problem->max_priority);
   }
 
-  child_node
-    = (child_node_t **) malloc((size_t) n_relocation*sizeof(child_node_t *));
-  child_node[0] = (child_node_t *) malloc((size_t) n_relocation
-                                       *max_n_child*sizeof(child_node_t));
+  free_problem(problem);
+}
 
-  stack_state
-    = (stack_state_t **) malloc((size_t) n_relocation*sizeof(stack_state_t *));
-  stack_state[0]
-    = (stack_state_t *) malloc((size_t) n_relocation*problem->n_stack
-                               *sizeof(stack_state_t));
+uchar solve(problem_t *problem, solution_t *solution)
+{
+  uchar ret;
+  solver_ctx_t *ctx = create_solver_ctx();
 
-  for(i = 1; i < n_relocation; ++i) {
-    child_node[i] = child_node[i - 1] + max_n_child;
-    stack_state[i] = stack_state[i - 1] + problem->n_stack;
-  }
+  ret = solve_ctx(ctx, problem, solution);
+  free_solver_ctx(ctx);
+
+  return(ret);
+}
 
-  clb_state = &(lb_state[0][max_n_child]);
+/*
+ * the working area of ctx is kept for the next problem of the same size
+ *
+ */
+uchar solve_ctx(solver_ctx_t *ctx, problem_t *problem, solution_t *solution)
+{
+#ifndef PURE_BRANCH_AND_BOUND
+  int ub, initial_lb, root_lb;
+  /* lower bound certified by the failed iterations */
+  int proven_lb;
+  /* nodes generated by the last two iterations */
+  ulint n_start, n_iteration = 0, n_previous;
+#endif /* !PURE_BRANCH_AND_BOUND */
+  uchar ret;
+  solver_option_t *option = &(ctx->option);
+  lb_state_t *clb_state;
 
-  initialize_lb_state(problem, state, clb_state);
+  clb_state = create_search(ctx, problem);
 
-  /* for dominance check */
-#ifdef TYPE1
-  last_change_bw = (int *) malloc((size_t) 3*problem->n_stack*sizeof(int));
-#else /* !TYPE1 */
-  last_change_bw
-    = (int *) malloc((size_t) (2*problem->n_stack + n_relocation)*sizeof(int));
-#endif /* !TYPE1 */
-  last_change_empty_bw = last_change_bw + problem->n_stack;
-  dominance_check = last_change_bw + 2*problem->n_stack;
-  if(problem->duplicate == True) {
-    last_priority_level
-      = (int **) malloc((size_t) (problem->max_priority + 1)*sizeof(int *));
-    last_priority_level[0]
-      = (int *) malloc((size_t) (problem->max_priority + 1)*problem->n_stack
-                       *sizeof(int));
-    for(i = 1; i <= problem->max_priority; ++i) {
-      last_priority_level[i] = last_priority_level[i - 1] + problem->n_stack;
-    }
+  if(ctx->state->n_misoverlay == 0) {
+    fprintf(stderr, "No relocation necessary.\n");
+    free_search(ctx);
+    solution->n_relocation = 0;
+    ctx->lb = 0;
+    return(True);
   }
 
-  lower_bound(problem, state, clb_state, MAX_N_RELOCATION, False);
-
 #ifdef LOWER_BOUND2
   fprintf(stderr, "initial lb=%d ", clb_state->lb);
-  fprintf(stderr, "lb2=%d(%d)\n", lower_bound2(problem, state, clb_state),
-          state->n_misoverlay);
+  fprintf(stderr, "lb2=%d(%d)\n",
+          lower_bound2(problem, ctx->state, clb_state, NULL, -1),
+          ctx->state->n_misoverlay);
 #else /* !LOWER_BOUND2 */
   fprintf(stderr, "initial lb=%d\n", clb_state->lb);
 #endif /* !LOWER_BOUND2 */
-  n_node = 1;
+  report_bound(ctx, problem, clb_state->lb);
+  ctx->n_node = 1;
 
   solution->n_relocation = MAX_N_RELOCATION + 1;
 
@@ -254,201 +554,1527 @@ uchar solve(problem_t *problem, solution_t *solution)
      < problem->n_stack) {
     /* upper bound computation */
     solution->n_relocation = 0;
-    if(heuristics(problem, state, solution, MAX_N_RELOCATION + 1)) {
+    if(heuristics(ctx->heuristics_work, problem, ctx->state, solution,
+                  MAX_N_RELOCATION + 1)) {
       fprintf(stderr, "initial ub=%d ", solution->n_relocation);
       print_time(problem);
+      report_solution(ctx, problem, solution, "heuristics");
     }
   }
 #endif /* HEURISTICS */
 
-  count = 0;
+  if(option->grasp_time > 0.0 && solution->n_relocation > clb_state->lb
+     && clb_state->n_dirty_stack + clb_state->n_full_clean_stack
+     < problem->n_stack) {
+    int n_relocation = solution->n_relocation;
+    double time_slice = option->grasp_time;
+
+    if(ctx->tlimit > 0.0) {
+      time_slice = min(time_slice, ctx->tlimit - get_time(problem));
+    }
+
+    /* randomized multi-start for a tighter initial upper bound */
+    grasp(problem, ctx->state, solution, clb_state->lb, time_slice,
+          ctx->n_thread);
+    if(solution->n_relocation < n_relocation) {
+      report_solution(ctx, problem, solution, "grasp");
+    }
+  }
+
+  if(option->pilot_method == True && solution->n_relocation > clb_state->lb) {
+    int n_relocation = solution->n_relocation;
+
+    /* one-step lookahead with greedy completion */
+    pilot(problem, ctx->state, solution, ctx->tlimit, ctx->n_thread);
+    if(solution->n_relocation < n_relocation) {
+      report_solution(ctx, problem, solution, "pilot");
+    }
+  }
+
+  ctx->count = 0;
   ret = True;
-  partial_solution = create_solution();
 
 #ifdef PURE_BRANCH_AND_BOUND
-  ret = bb(problem, solution, clb_state, 1);
+  ret = bb(ctx, problem, solution, clb_state, -1);
 #else /* !PURE_BRANCH_AND_BOUND */
-  /* main loop */
-  for(ub = clb_state->lb; ub < solution->n_relocation; ++ub) {
-    fprintf(stderr, "cub=%d ", ub);
+  initial_lb = root_lb = clb_state->lb;
+  if(option->lookahead_depth > 0 && option->lb_weight <= 1.0
+     && solution->n_relocation > root_lb + ctx->gap) {
+    /* lower bound by lookahead of lookahead_depth relocations (the */
+    /* probes failed with the weighted bound would prove nothing) */
+    ret = speculate(ctx, problem, solution, root_lb, &root_lb,
+                    ctx->n_thread, option->lookahead_depth);
+    fprintf(stderr, "lookahead lb=%d ", root_lb);
     print_time(problem);
-    if((ret = bb(problem, solution, &ub, clb_state, 1)) == TimeLimit) {
-      break;
+    report_bound(ctx, problem, root_lb);
+  }
+
+  proven_lb = root_lb;
+  if(ret == TimeLimit) {
+    /* no search after the lookahead stopped by the time limit */
+    fprintf(stderr, "Time limit reached in the lookahead.\n");
+  } else if(option->lds_mode == True) {
+    ret = lds(ctx, problem, solution, clb_state);
+  } else if(option->restart_unit > 0 && option->lb_weight <= 1.0) {
+    ret = restart(ctx, problem, solution, clb_state, &proven_lb);
+  } else if(option->n_speculation > 1 && option->lb_weight <= 1.0) {
+    ret = speculate(ctx, problem, solution, root_lb, &proven_lb,
+                    option->n_speculation, 0);
+  } else {
+    /* main loop */
+    for(ub = WEIGHTED_LB(ctx, root_lb); ; ++ub) {
+      /* g + w*h <= w*opt holds on an optimal path */
+      proven_lb = max(root_lb, (int) ((ub - 1)/option->lb_weight) + 1);
+      if(solution->n_relocation <= proven_lb + ctx->gap) {
+        break;
+      } else if(ub >= solution->n_relocation) {
+        /* the solutions found by the iteration are no better than the */
+        /* incumbent, which is within lb_weight of the optimum */
+        break;
+      }
+
+      fprintf(stderr, "cub=%d ", ub);
+      print_time(problem);
+      ctx->stop_ub = max(ub, proven_lb + ctx->gap);
+      n_start = ctx->n_node;
+      if((ret = bb(ctx, problem, solution, &ub, clb_state, -1)) != False) {
+        break;
+      }
+      report_iteration(ctx, problem, ub,
+                       max(root_lb, (int) (ub/option->lb_weight) + 1));
+
+      n_previous = n_iteration;
+      n_iteration = ctx->n_node - n_start;
+      if(option->hybrid_mode == True && option->lb_weight <= 1.0
+         && n_previous > 0 && solution->n_relocation <= MAX_N_RELOCATION
+         && switch_to_dfbnb(solution->n_relocation - 1 - ctx->gap - ub,
+                            (double) n_iteration/(double) n_previous)) {
+        proven_lb = max(proven_lb, ub + 1);
+        ret = dfbnb(ctx, problem, solution, clb_state, &proven_lb);
+        break;
+      }
     }
   }
+
+  if(proven_lb > solution->n_relocation) {
+    /* an inadmissible bound has cut off a solution: only the lower */
+    /* bound of the initial state is valid */
+    fprintf(stderr, "Invalid lb=%d above the solution.\n", proven_lb);
+    proven_lb = min(initial_lb, solution->n_relocation);
+  }
+  if(option->lds_mode == False && (ctx->gap > 0 || option->lb_weight > 1.0)) {
+    fprintf(stderr, "lb=%d gap=%d\n", proven_lb,
+            solution->n_relocation - proven_lb);
+  }
+#endif /* !PURE_BRANCH_AND_BOUND */
+
+  fprintf(stderr, "nodes=%llu\n", ctx->n_node);
+#ifdef LOWER_BOUND2
+  if(option->verbose == True) {
+    fprintf(stderr, "lb2 evaluations=%llu cutoffs=%llu\n", ctx->n_lb2,
+            ctx->n_lb2_cut);
+  }
+#endif /* LOWER_BOUND2 */
+#ifdef ADAPTIVE_LOWER_BOUND
+  if(option->verbose == True) {
+    fprintf(stderr, "skipped lb2=%llu flow=%llu\n",
+            ctx->n_lb_skip[SECOND_BOUND], ctx->n_lb_skip[FLOW_BOUND]);
+  }
+#endif /* ADAPTIVE_LOWER_BOUND */
+
+  free_search(ctx);
+
+#ifdef PURE_BRANCH_AND_BOUND
+  ctx->lb = clb_state->lb;
+#else /* !PURE_BRANCH_AND_BOUND */
+  ctx->lb = proven_lb;
+  if(option->lds_mode == False && solution->n_relocation > proven_lb) {
+    /* the solution is not proven optimal */
+    return(False);
+  }
 #endif /* !PURE_BRANCH_AND_BOUND */
+  if(ret == TimeLimit) {
+    return(False);
+  }
+  report_bound(ctx, problem, solution->n_relocation);
 
-  fprintf(stderr, "nodes=%llu\n", n_node);
-
-  free_solution(partial_solution);
-  if(problem->duplicate == True) {
-    free(last_priority_level[0]);
-    free(last_priority_level);
-  }
-  free(last_change_bw);
-  free(stack_state[0]);
-  free(stack_state);
-  free(child_node[0]);
-  free(child_node);
-  free(lb_state[0][0].removal_for_supply);
-  free(lb_state[0][0].demand);
-  free(lb_state[0]);
-  free(lb_state);
-  free(lb_work);
-  free_state(state);
-  heuristics(NULL, NULL, NULL, 0);
-
-  return((ret == TimeLimit)?False:True);
+  return(True);
 }
 
+/*
+ * search below the root node whose lower bound state is clb_state
+ * discrepancy: the number of child nodes other than the first one
+ * allowed on the path below the root node (negative: unlimited)
+ *
+ */
 #ifdef PURE_BRANCH_AND_BOUND
-uchar bb(problem_t *problem, solution_t *solution, lb_state_t *plb_state,
-         int level)
+uchar bb(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+         lb_state_t *clb_state, int discrepancy)
 #else /* !PURE_BRANCH_AND_BOUND */
-uchar bb(problem_t *problem, solution_t *solution, int *ub,
-         lb_state_t *plb_state, int level)
+uchar bb(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+         int *ub, lb_state_t *clb_state, int discrepancy)
 #endif /* !PURE_BRANCH_AND_BOUND */
 {
-  int i, j, k;
-  int n_child, last_change;
-  int n_misoverlay = state->n_misoverlay;
+  ctx->path[1].lb_state = clb_state;
+  ctx->path[1].discrepancy = discrepancy;
+  ctx->path[1].expanded = False;
+  ctx->depth = 1;
+
+#ifdef PURE_BRANCH_AND_BOUND
+  return(search(ctx, problem, solution));
+#else /* !PURE_BRANCH_AND_BOUND */
+  return(search(ctx, problem, solution, ub));
+#endif /* !PURE_BRANCH_AND_BOUND */
+}
+
+/*
+ * depth-first search along the path of ctx with an explicit stack
+ * False: the nodes below the path are searched, True: a solution is
+ * found or the search is terminated by it, and the path is discarded.
+ * the search stopped by TimeLimit or Interrupted resumes from the node
+ * path[depth] on the next call.
+ *
+ */
+#ifdef PURE_BRANCH_AND_BOUND
+uchar search(solver_ctx_t *ctx, problem_t *problem, solution_t *solution)
+#else /* !PURE_BRANCH_AND_BOUND */
+uchar search(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+             int *ub)
+#endif /* !PURE_BRANCH_AND_BOUND */
+{
+  int k, level = ctx->depth, n_child;
   uchar ret;
-  block_t reloc_block;
-  block_state_t block_state_backup;
-  block_state_t *block_state;
-  stack_state_t *stack = state->stack;
-  stack_state_t *stack_backup = stack_state[level];
-  stack_state_t src_stack, dst_stack;
-  lb_state_t *slb_state = &(lb_state[level][0]);
-  child_node_t *cnode = child_node[level];
+  state_t *state = ctx->state;
+  search_node_t *node;
+  lb_state_t *slb_state;
+  child_node_t *cnode;
 
+  while(level > 0) {
+    node = &(ctx->path[level]);
+
+    if(node->expanded == False) {
 #ifdef PURE_BRANCH_AND_BOUND
-  if(level > MAX_N_RELOCATION) {
-    return(False);
-  }
+      if(level > MAX_N_RELOCATION) {
 #else /* !PURE_BRANCH_AND_BOUND */
-  if(level > *ub) {
-    return(False);
+      if(level > *ub) {
+#endif /* !PURE_BRANCH_AND_BOUND */
+        /* no child node */
+        node->n_child = node->next = node->end = 0;
+      } else {
+        if(ctx->node_limit > 0 && ctx->n_node >= ctx->node_limit) {
+          ctx->depth = level;
+          return(Interrupted);
+        }
+
+#ifndef PURE_BRANCH_AND_BOUND
+        if(ctx->depth_limit > 0 && level > ctx->depth_limit) {
+          /* a node within ub is found at the probing depth */
+          ctx->depth_reached = True;
+          ctx->depth = level;
+          return(Interrupted);
+        }
+#endif /* !PURE_BRANCH_AND_BOUND */
+
+        if((ctx->tlimit > 0.0 || ctx->speculation != NULL)
+           && ++ctx->count == CHECK_INTERVAL) {
+          ctx->count = 0;
+          if(ctx->tlimit > 0.0 && get_time(problem) >= ctx->tlimit) {
+            ctx->depth = level;
+            return(TimeLimit);
+          }
+#ifndef PURE_BRANCH_AND_BOUND
+          if(ctx->speculation != NULL
+             && (*ub >= ctx->speculation->cutoff
+                 || ctx->speculation->best
+                    <= ctx->speculation->proven_lb + ctx->gap)) {
+            /* a solution within this iteration is already known */
+            ctx->depth = level;
+            return(Interrupted);
+          }
+#endif /* !PURE_BRANCH_AND_BOUND */
+        }
+
+#if 0
+        printf("------\n");
+#ifdef PURE_BRANCH_AND_BOUND
+        printf("ub=%d, level=%d lb=%d lbGX=%d lbBX=%d\n",
+               solution->n_relocation, level, node->lb_state->lb,
+               node->lb_state->lbGX, node->lb_state->lbBX);
+#else /* !PURE_BRANCH_AND_BOUND */
+        printf("ub=%d, level=%d lb=%d lbGX=%d lbBX=%d\n", *ub, level,
+               node->lb_state->lb, node->lb_state->lbGX,
+               node->lb_state->lbBX);
+#endif /* !PURE_BRANCH_AND_BOUND */
+        print_state(problem, state, stderr);
+        print_solution_relocation(problem, ctx->partial_solution, stderr);
+#endif
+
+        /* generate child nodes */
+        node->n_misoverlay = state->n_misoverlay;
+#ifdef PURE_BRANCH_AND_BOUND
+        ret = bb_sub(ctx, problem, solution, node->lb_state, level, &n_child);
+#else /* !PURE_BRANCH_AND_BOUND */
+        ret = bb_sub(ctx, problem, solution, ub, node->lb_state, level,
+                     &n_child);
+#endif /* !PURE_BRANCH_AND_BOUND */
+        if(ret != False) {
+          /* an optimal solution is found, or the search is terminated */
+          ctx->depth = 0;
+          return(ret);
+        }
+        node->n_child = node->end = n_child;
+        node->next = node->n_searched = 0;
+      }
+      node->expanded = True;
+    }
+
+    /* branching */
+    slb_state = ctx->lb_state[level];
+    cnode = ctx->child_node[level];
+    for(; node->next < node->end; ++node->next) {
+      k = node->next;
+
+      /* bounding (unnecessary) */
+#ifdef PURE_BRANCH_AND_BOUND
+      if(slb_state[cnode[k].index].lb + level < solution->n_relocation) {
+        break;
+      }
+#else /* !PURE_BRANCH_AND_BOUND */
+      if(WEIGHTED_LB(ctx, slb_state[cnode[k].index].lb) + level <= *ub) {
+        break;
+      }
+#endif /* !PURE_BRANCH_AND_BOUND */
+    }
+
+    if(node->next < node->end && node->n_searched > 0
+       && node->discrepancy == 0) {
+      /* limited discrepancy search */
+      ctx->lds_cut = True;
+      node->next = node->end;
+    }
+
+    if(node->next < node->end) {
+      enter_child(ctx, level);
+      ++level;
+    } else if(--level > 0) {
+      /* all the child nodes are searched */
+      leave_child(ctx, level);
+    }
+  }
+
+  ctx->depth = 0;
+  return(False);
+}
+
+/*
+ * move the state of ctx to the child node next of path[level], and
+ * push the child node on the path
+ *
+ */
+void enter_child(solver_ctx_t *ctx, int level)
+{
+  int i, j;
+  block_t reloc_block;
+  block_state_t *block_state;
+  state_t *state = ctx->state;
+  stack_state_t *stack = state->stack;
+  stack_state_t *stack_backup = ctx->stack_state[level];
+  search_node_t *node = &(ctx->path[level]);
+  search_node_t *child = &(ctx->path[level + 1]);
+  child_node_t *cnode = &(ctx->child_node[level][node->next]);
+
+  ++node->next;
+
+  /* update the information for the child node */
+  i = node->src = cnode->src;
+  j = node->dst = cnode->dst;
+  node->src_stack = stack[i];
+  node->dst_stack = stack[j];
+  node->block_state_backup = state->block_state[i][stack[i].n_tier];
+
+  reloc_block = node->reloc_block = state->block[i][stack[i].n_tier - 1];
+  state->block[j][stack[j].n_tier] = reloc_block;
+
+  stack[i] = stack_backup[i];
+  stack[j] = cnode->dst_stack;
+  state->n_misoverlay = cnode->n_misoverlay;
+
+  block_state = state->block_state[j];
+
+  if(stack[j].n_clean == stack[j].n_tier) {
+    block_state[stack[j].n_tier].misoverlay_priority = 0;
+    block_state[stack[j].n_tier].upside_down = False;
+  } else if(stack[j].n_clean + 1 == stack[j].n_tier) {
+    block_state[stack[j].n_tier].misoverlay_priority = reloc_block.priority;
+    block_state[stack[j].n_tier].upside_down = True;
+  } else if(reloc_block.priority
+            >= block_state[stack[j].n_tier - 1].misoverlay_priority) {
+    block_state[stack[j].n_tier].misoverlay_priority = reloc_block.priority;
+    block_state[stack[j].n_tier].upside_down
+      = block_state[stack[j].n_tier - 1].upside_down;
+  } else {
+    block_state[stack[j].n_tier].misoverlay_priority
+      = block_state[stack[j].n_tier - 1].misoverlay_priority;
+    block_state[stack[j].n_tier].upside_down = False;
+  }
+
+  /* update the partial solution */
+  ctx->partial_solution->n_relocation = level - 1;
+  add_relocation(ctx->partial_solution, i, j, &reloc_block);
+
+  node->last_change = state->last_relocation[reloc_block.no];
+  state->last_relocation[reloc_block.no] = level;
+
+  child->lb_state = &(ctx->lb_state[level][cnode->index]);
+  child->discrepancy = (node->n_searched++ > 0)?node->discrepancy - 1
+    :node->discrepancy;
+  child->expanded = False;
+}
+
+/*
+ * recover the state of ctx from the child node of path[level]
+ *
+ */
+void leave_child(solver_ctx_t *ctx, int level)
+{
+  state_t *state = ctx->state;
+  stack_state_t *stack = state->stack;
+  search_node_t *node = &(ctx->path[level]);
+
+  stack[node->src] = node->src_stack;
+  stack[node->dst] = node->dst_stack;
+  state->block_state[node->src][node->src_stack.n_tier]
+    = node->block_state_backup;
+
+  state->last_relocation[node->reloc_block.no] = node->last_change;
+  state->n_misoverlay = node->n_misoverlay;
+  state->block[node->src][stack[node->src].n_tier - 1] = node->reloc_block;
+}
+
+/*
+ * start an iteration searching for a solution of at most ub relocations
+ * on ctx, which can be suspended, resumed, split between the contexts
+ * and saved.  the working areas for the problem are kept on ctx until
+ * end_iteration(), and the lower bound at the root node is returned
+ * (0: no relocation is necessary, and the iteration is not started).
+ *
+ */
+int start_iteration(solver_ctx_t *ctx, problem_t *problem, int ub)
+{
+  lb_state_t *clb_state = create_search(ctx, problem);
+
+  ctx->ub = ub;
+#ifndef PURE_BRANCH_AND_BOUND
+  ctx->stop_ub = ub;
+#endif /* !PURE_BRANCH_AND_BOUND */
+  ctx->lds_cut = False;
+  ctx->depth = 0;
+
+  if(ctx->state->n_misoverlay == 0) {
+    return(0);
+  }
+
+  ctx->path[1].lb_state = clb_state;
+  ctx->path[1].discrepancy = -1;
+  ctx->path[1].expanded = False;
+  ctx->depth = 1;
+
+  return(clb_state->lb);
+}
+
+/*
+ * run the iteration of ctx until about n_node more nodes are generated
+ * (0: no limit).  False: no solution within the bound (or the iteration
+ * is over), True: solution is improved within the bound, Interrupted:
+ * suspended, and TimeLimit.  the iteration resumes on the next call after
+ * Interrupted and TimeLimit.  only the size of solution is needed unless
+ * it is improved.
+ *
+ */
+uchar run_iteration(solver_ctx_t *ctx, problem_t *problem,
+                    solution_t *solution, ulint n_node)
+{
+  uchar ret;
+
+  if(ctx->depth == 0) {
+    return(False);
+  }
+
+  ctx->node_limit = (n_node > 0)?ctx->n_node + n_node:0;
+#ifdef PURE_BRANCH_AND_BOUND
+  ret = search(ctx, problem, solution);
+#else /* !PURE_BRANCH_AND_BOUND */
+  ret = search(ctx, problem, solution, &(ctx->ub));
+#endif /* !PURE_BRANCH_AND_BOUND */
+  ctx->node_limit = 0;
+
+  return(ret);
+}
+
+/*
+ * hand off about a half of the child nodes left at the shallowest
+ * level of the path of ctx to to, which has been started on the same
+ * problem (its own path is discarded)
+ * returns False if no child node is left to hand off.
+ *
+ */
+uchar split_iteration(solver_ctx_t *ctx, problem_t *problem,
+                      solver_ctx_t *to)
+{
+  int level, split, n_handoff = 0;
+  search_node_t *node;
+
+  for(split = 1; split <= ctx->depth; ++split) {
+    node = &(ctx->path[split]);
+    if(node->expanded == True) {
+      /* the child node being searched is kept */
+      n_handoff = (split < ctx->depth)?(node->end - node->next + 1)/2
+        :(node->end - node->next)/2;
+      if(n_handoff > 0) {
+        break;
+      }
+    }
+  }
+  if(split > ctx->depth) {
+    return(False);
+  }
+
+  to->ub = ctx->ub;
+#ifndef PURE_BRANCH_AND_BOUND
+  to->stop_ub = ctx->stop_ub;
+#endif /* !PURE_BRANCH_AND_BOUND */
+#ifdef ADAPTIVE_LOWER_BOUND
+  memcpy((void *) to->lb_statistics, (void *) ctx->lb_statistics,
+         sizeof(ctx->lb_statistics));
+#endif /* ADAPTIVE_LOWER_BOUND */
+
+  /* follow the path of ctx down to the split level */
+  initialize_state(problem, to->state);
+  for(level = 1; level <= split; ++level) {
+    copy_node(to, problem, ctx, level);
+    if(level < split) {
+      to->path[level].next = ctx->path[level].next - 1;
+      --to->path[level].n_searched;
+      enter_child(to, level);
+      /* the other child nodes are left to ctx */
+      to->path[level].end = to->path[level].next;
+    }
+  }
+
+  ctx->path[split].end -= n_handoff;
+  to->path[split].next = ctx->path[split].end;
+  to->depth = split;
+
+  return(True);
+}
+
+/*
+ * copy path[level] of from and its child nodes to ctx
+ * (the lower bound state of path[1] is that of the root node)
+ *
+ */
+void copy_node(solver_ctx_t *ctx, problem_t *problem, solver_ctx_t *from,
+               int level)
+{
+  int k;
+  int max_n_child = problem->n_stack*(problem->n_stack - 1) + 1;
+  search_node_t *node = &(ctx->path[level]);
+  lb_state_t *lb_state = (level == 1)?&(ctx->lb_state[0][max_n_child])
+    :node->lb_state;
+
+  *node = from->path[level];
+  node->lb_state = lb_state;
+  if(level == 1) {
+    copy_lb_state(problem, lb_state, from->path[1].lb_state);
+  }
+
+  if(node->expanded == True) {
+    memcpy((void *) ctx->child_node[level], (void *) from->child_node[level],
+           (size_t) node->n_child*sizeof(child_node_t));
+    memcpy((void *) ctx->stack_state[level], (void *) from->stack_state[level],
+           (size_t) problem->n_stack*sizeof(stack_state_t));
+    for(k = 0; k < node->n_child; ++k) {
+      copy_lb_state(problem, &(ctx->lb_state[level][k]),
+                    &(from->lb_state[level][k]));
+    }
+  }
+}
+
+/*
+ * save the iteration of ctx, which is suspended
+ *
+ */
+uchar save_iteration(solver_ctx_t *ctx, problem_t *problem, FILE *fp)
+{
+  int level;
+  search_header_t header;
+
+  memset((void *) &header, 0, sizeof(search_header_t));
+  memcpy((void *) header.magic, (void *) SEARCH_MAGIC, sizeof(SEARCH_MAGIC));
+  header.n_stack = problem->n_stack;
+  header.s_height = problem->s_height;
+  header.n_block = problem->n_block;
+  header.max_priority = problem->max_priority;
+  header.depth = ctx->depth;
+  header.ub = ctx->ub;
+#ifndef PURE_BRANCH_AND_BOUND
+  header.stop_ub = ctx->stop_ub;
+#endif /* !PURE_BRANCH_AND_BOUND */
+#ifdef ADAPTIVE_LOWER_BOUND
+  header.statistics_size = (int) sizeof(ctx->lb_statistics);
+#endif /* ADAPTIVE_LOWER_BOUND */
+
+  if(fwrite((void *) &header, sizeof(search_header_t), 1, fp) != 1) {
+    return(False);
+  }
+#ifdef ADAPTIVE_LOWER_BOUND
+  if(fwrite((void *) ctx->lb_statistics, sizeof(ctx->lb_statistics), 1, fp)
+     != 1) {
+    return(False);
+  }
+#endif /* ADAPTIVE_LOWER_BOUND */
+  for(level = 1; level <= ctx->depth; ++level) {
+    if(write_node(ctx, problem, level, fp) == False) {
+      return(False);
+    }
+  }
+
+  return(True);
+}
+
+/*
+ * load an iteration saved by save_iteration() into ctx, which has been
+ * started on the same problem
+ *
+ */
+uchar load_iteration(solver_ctx_t *ctx, problem_t *problem, FILE *fp)
+{
+  int level;
+  search_header_t header;
+
+  if(fread((void *) &header, sizeof(search_header_t), 1, fp) != 1
+     || memcmp((void *) header.magic, (void *) SEARCH_MAGIC,
+               sizeof(SEARCH_MAGIC)) != 0
+     || header.n_stack != problem->n_stack
+     || header.s_height != problem->s_height
+     || header.n_block != problem->n_block
+     || header.max_priority != problem->max_priority
+     || header.depth < 0 || header.depth > MAX_N_RELOCATION + 1) {
+    return(False);
+  }
+#ifdef ADAPTIVE_LOWER_BOUND
+  if(header.statistics_size != (int) sizeof(ctx->lb_statistics)
+     || fread((void *) ctx->lb_statistics, sizeof(ctx->lb_statistics), 1, fp)
+     != 1) {
+    return(False);
+  }
+#else /* !ADAPTIVE_LOWER_BOUND */
+  if(header.statistics_size != 0) {
+    return(False);
+  }
+#endif /* !ADAPTIVE_LOWER_BOUND */
+
+  ctx->depth = 0;
+  ctx->ub = header.ub;
+#ifndef PURE_BRANCH_AND_BOUND
+  ctx->stop_ub = header.stop_ub;
+#endif /* !PURE_BRANCH_AND_BOUND */
+
+  /* follow the path from the initial state */
+  initialize_state(problem, ctx->state);
+  for(level = 1; level <= header.depth; ++level) {
+    if(read_node(ctx, problem, level, fp) == False
+       || (level < header.depth && (ctx->path[level].expanded != True
+                                    || ctx->path[level].next == 0))) {
+      return(False);
+    }
+    if(level < header.depth) {
+      --ctx->path[level].next;
+      enter_child(ctx, level);
+    }
+  }
+  ctx->depth = header.depth;
+
+  return(True);
+}
+
+/*
+ * write path[level] of ctx and its child nodes
+ * (the lower bound state of path[1] is written as well)
+ *
+ */
+uchar write_node(solver_ctx_t *ctx, problem_t *problem, int level, FILE *fp)
+{
+  int k, value[5];
+  int size = lb_state_size(problem);
+  search_node_t *node = &(ctx->path[level]);
+  lb_state_t *lb_state;
+
+  if(fwrite((void *) node, sizeof(search_node_t), 1, fp) != 1) {
+    return(False);
+  }
+
+  for(k = (level == 1)?-1:0; k < ((node->expanded == True)?node->n_child:0);
+      ++k) {
+    lb_state = (k < 0)?node->lb_state:&(ctx->lb_state[level][k]);
+    value[0] = lb_state->lb;
+    value[1] = lb_state->lbBX;
+    value[2] = lb_state->lbGX;
+    value[3] = lb_state->n_dirty_stack;
+    value[4] = lb_state->n_full_clean_stack;
+    if(fwrite((void *) value, sizeof(int), 5, fp) != 5
+       || fwrite((void *) lb_state->demand, sizeof(int), (size_t) size, fp)
+       != (size_t) size) {
+      return(False);
+    }
+  }
+
+  if(node->expanded == True
+     && (fwrite((void *) ctx->child_node[level], sizeof(child_node_t),
+                (size_t) node->n_child, fp) != (size_t) node->n_child
+         || fwrite((void *) ctx->stack_state[level], sizeof(stack_state_t),
+                   (size_t) problem->n_stack, fp)
+         != (size_t) problem->n_stack)) {
+    return(False);
+  }
+
+  return(True);
+}
+
+/*
+ * read path[level] of ctx and its child nodes written by write_node()
+ *
+ */
+uchar read_node(solver_ctx_t *ctx, problem_t *problem, int level, FILE *fp)
+{
+  int k, value[5];
+  int max_n_child = problem->n_stack*(problem->n_stack - 1) + 1;
+  int size = lb_state_size(problem);
+  search_node_t *node = &(ctx->path[level]);
+  lb_state_t *lb_state = (level == 1)?&(ctx->lb_state[0][max_n_child])
+    :node->lb_state;
+  child_node_t *cnode = ctx->child_node[level];
+
+  if(fread((void *) node, sizeof(search_node_t), 1, fp) != 1) {
+    return(False);
+  }
+  node->lb_state = lb_state;
+  if(node->expanded == True
+     && (node->n_child < 0 || node->n_child > max_n_child
+         || node->next < 0 || node->next > node->end
+         || node->end > node->n_child)) {
+    return(False);
+  }
+
+  for(k = (level == 1)?-1:0; k < ((node->expanded == True)?node->n_child:0);
+      ++k) {
+    lb_state = (k < 0)?node->lb_state:&(ctx->lb_state[level][k]);
+    if(fread((void *) value, sizeof(int), 5, fp) != 5
+       || fread((void *) lb_state->demand, sizeof(int), (size_t) size, fp)
+       != (size_t) size) {
+      return(False);
+    }
+    lb_state->lb = value[0];
+    lb_state->lbBX = value[1];
+    lb_state->lbGX = value[2];
+    lb_state->n_dirty_stack = value[3];
+    lb_state->n_full_clean_stack = value[4];
+  }
+
+  if(node->expanded == True
+     && (fread((void *) cnode, sizeof(child_node_t), (size_t) node->n_child,
+               fp) != (size_t) node->n_child
+         || fread((void *) ctx->stack_state[level], sizeof(stack_state_t),
+                  (size_t) problem->n_stack, fp)
+         != (size_t) problem->n_stack)) {
+    return(False);
+  }
+
+  for(k = 0; k < ((node->expanded == True)?node->n_child:0); ++k) {
+    if(cnode[k].index < 0 || cnode[k].index >= node->n_child
+       || cnode[k].src < 0 || cnode[k].src >= problem->n_stack
+       || cnode[k].dst < 0 || cnode[k].dst >= problem->n_stack) {
+      return(False);
+    }
+  }
+
+  return(True);
+}
+
+/*
+ * end the iteration of ctx, and free its working areas for the problem
+ *
+ */
+void end_iteration(solver_ctx_t *ctx)
+{
+  ctx->depth = 0;
+  free_search(ctx);
+}
+
+#ifndef PURE_BRANCH_AND_BOUND
+/*
+ * limited discrepancy search
+ * paths deviating from the best-first order at most 0, 1, 2, ... times
+ * are searched for a solution better than the incumbent.  the incumbent
+ * is optimal when no child node is left by the discrepancy limit.
+ *
+ */
+uchar lds(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+          lb_state_t *clb_state)
+{
+  int ub, discrepancy;
+  uchar ret = True;
+
+  for(discrepancy = 0; solution->n_relocation > clb_state->lb;
+      ++discrepancy) {
+    fprintf(stderr, "discrepancy=%d ", discrepancy);
+    print_time(problem);
+
+    ctx->lds_cut = False;
+    ctx->stop_ub = ub = solution->n_relocation - 1;
+    if((ret = bb(ctx, problem, solution, &ub, clb_state, discrepancy))
+       == TimeLimit) {
+      break;
+    } else if(ret == True) {
+      /* the search is terminated without recovering the state */
+      initialize_state(problem, ctx->state);
+      /* retry with the improved incumbent */
+      --discrepancy;
+    } else if(ctx->lds_cut == False) {
+      /* all the child nodes are searched */
+      break;
+    }
+  }
+
+  return(ret);
+}
+
+/*
+ * n_left more iterations are needed in the worst case, and each costs
+ * growth times as many nodes as the previous one.  the last of them is
+ * about as large as a depth-first b&b pass bounded by the incumbent, so
+ * the iterations cost sum_{t=0}^{n_left-1} growth^{-t} times the pass.
+ *
+ */
+uchar switch_to_dfbnb(int n_left, double growth)
+{
+  int t;
+  double ratio = 0.0, factor = 1.0;
+
+  growth = max(1.0, growth);
+  for(t = 0; t < n_left && ratio <= HYBRID_RATIO; ++t) {
+    ratio += factor;
+    factor /= growth;
+  }
+
+  return((ratio > HYBRID_RATIO)?True:False);
+}
+
+/*
+ * depth-first b&b with the incumbent as the bound
+ * the bound is tightened whenever a better solution is found.
+ * proven_lb is updated when the tree is exhausted.
+ *
+ */
+uchar dfbnb(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+            lb_state_t *clb_state, int *proven_lb)
+{
+  int ub = solution->n_relocation - 1 - ctx->gap;
+  uchar ret;
+
+  fprintf(stderr, "dfbnb ub=%d ", ub);
+  print_time(problem);
+
+  ctx->dfbnb_mode = True;
+  ctx->stop_ub = *proven_lb + ctx->gap;
+  if((ret = bb(ctx, problem, solution, &ub, clb_state, -1)) == False) {
+    /* no solution with ub relocations or less */
+    *proven_lb = max(*proven_lb, ub + 1);
+    report_iteration(ctx, problem, ub, *proven_lb);
+    ret = True;
+  }
+  ctx->dfbnb_mode = False;
+
+  return(ret);
+}
+
+/*
+ * randomized restarts
+ * the dominance rules depend on the order of the stacks, so the search
+ * is restarted on a random permutation of the stacks when the number
+ * of nodes exceeds unit*luby(i) in the i-th run.  the failed
+ * iterations do not depend on the order, and the next run resumes
+ * from proven_lb with the incumbent carried over.  unit starts from
+ * restart_unit (at least RESTART_MIN_UNIT) and is doubled whenever a
+ * run ends without completing an iteration, so that an iteration
+ * longer than unit is not restarted over and over.
+ *
+ */
+uchar restart(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+              lb_state_t *clb_state, int *proven_lb)
+{
+  int i, j, k, ub, n_restart, start_lb;
+  int *perm = (int *) malloc((size_t) problem->n_stack*sizeof(int));
+  uint seed = 1;
+  ulint unit = (ulint) max(ctx->option.restart_unit, RESTART_MIN_UNIT);
+  uchar ret = True;
+  problem_t *pproblem;
+  solution_t *psolution = create_solution();
+  restart_t run;
+
+  /* the improvements are reported with the stacks mapped back */
+  run.problem = problem;
+  run.solution = create_solution();
+  run.best = solution->n_relocation;
+  run.perm = perm;
+  run.callback = ctx->callback;
+  run.callback_arg = ctx->callback_arg;
+  if(ctx->callback != NULL) {
+    solver_ctx_set_callback(ctx, restart_solution, (void *) &run);
+  }
+  for(i = 0; i < problem->n_stack; ++i) {
+    perm[i] = i;
+  }
+
+  for(n_restart = 1; solution->n_relocation > *proven_lb + ctx->gap;
+      ++n_restart) {
+    if(n_restart > 1) {
+      for(i = problem->n_stack - 1; i > 0; --i) {
+        j = (int) (rand_r(&seed) % (uint) (i + 1));
+        k = perm[i];
+        perm[i] = perm[j];
+        perm[j] = k;
+      }
+    }
+
+    pproblem = permute_problem(problem, perm);
+    initialize_state(pproblem, ctx->state);
+    initialize_lb_state(pproblem, ctx->state, clb_state);
+    lower_bound(ctx->lb_work, pproblem, ctx->state, clb_state,
+                MAX_N_RELOCATION, False);
+
+    ctx->node_limit = ctx->n_node + unit*(ulint) luby(n_restart);
+    psolution->n_relocation = solution->n_relocation;
+    start_lb = *proven_lb;
+
+    fprintf(stderr, "restart=%d ", n_restart);
+    print_time(problem);
+
+    for(ub = *proven_lb; solution->n_relocation > *proven_lb + ctx->gap;
+        ++ub) {
+      fprintf(stderr, "cub=%d ", ub);
+      print_time(problem);
+      ctx->stop_ub = max(ub, *proven_lb + ctx->gap);
+      if((ret = bb(ctx, pproblem, psolution, &ub, clb_state, -1)) != False) {
+        break;
+      }
+      *proven_lb = ub + 1;
+      report_iteration(ctx, problem, ub, *proven_lb);
+    }
+
+    if(psolution->n_relocation < solution->n_relocation) {
+      /* map the stacks back to the original order */
+      copy_solution(solution, psolution);
+      for(i = 0; i < solution->n_relocation; ++i) {
+        solution->relocation[i].src = perm[solution->relocation[i].src];
+        solution->relocation[i].dst = perm[solution->relocation[i].dst];
+      }
+    }
+
+    free_problem(pproblem);
+
+    if(ret == TimeLimit) {
+      break;
+    } else if(ret == Interrupted && *proven_lb == start_lb) {
+      /* the iteration is longer than the run */
+      unit *= 2;
+    }
+  }
+
+  solver_ctx_set_callback(ctx, run.callback, run.callback_arg);
+  ctx->node_limit = 0;
+  free_solution(run.solution);
+  free_solution(psolution);
+  free(perm);
+
+  return((ret == TimeLimit)?TimeLimit:True);
+}
+
+/* i-th term of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ... */
+int luby(int i)
+{
+  int k;
+
+  for(k = 1; (1 << k) - 1 < i; ++k);
+
+  while((1 << k) - 1 != i) {
+    i -= (1 << (k - 1)) - 1;
+    for(k = 1; (1 << k) - 1 < i; ++k);
+  }
+
+  return(1 << (k - 1));
+}
+
+/*
+ * speculative search
+ * n_worker threads run consecutive iterations ub=lb, lb+1, ...
+ * concurrently, each with its own working area.  an iteration is
+ * interrupted when a solution of at most ub relocations has been
+ * found by another one.  the incumbent is optimal when all the
+ * iterations below its size have failed.
+ *
+ * depth > 0: probing
+ * the iterations stop at the nodes of the given depth, and an iteration
+ * succeeds when such a node is found.  proven_lb is then the lookahead
+ * bound, i.e., 1 + min(bound of the child nodes) applied depth times.
+ *
+ */
+uchar speculate(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+                int lb, int *proven_lb, int n_worker, int depth)
+{
+  int i;
+  speculation_t spec;
+  pthread_t *thread;
+
+  spec.problem = problem;
+  spec.solution = solution;
+  spec.best = spec.cutoff = solution->n_relocation;
+  spec.depth = depth;
+  spec.next_ub = spec.proven_lb = lb;
+  spec.failed = (uchar *) calloc((size_t) MAX_N_RELOCATION + 2,
+                                 sizeof(uchar));
+  spec.time_limit = False;
+  spec.tlimit = ctx->tlimit;
+  spec.gap = ctx->gap;
+  spec.ctx = ctx;
+  spec.n_node = 0;
+  pthread_mutex_init(&(spec.mutex), NULL);
+
+  thread = (pthread_t *) malloc((size_t) n_worker*sizeof(pthread_t));
+  for(i = 0; i < n_worker; ++i) {
+    pthread_create(&(thread[i]), NULL, speculation_worker, (void *) &spec);
+  }
+  for(i = 0; i < n_worker; ++i) {
+    pthread_join(thread[i], NULL);
+  }
+
+  ctx->n_node += spec.n_node;
+  *proven_lb = spec.proven_lb;
+
+  free(thread);
+  free(spec.failed);
+  pthread_mutex_destroy(&(spec.mutex));
+
+  return((spec.time_limit == True)?TimeLimit:True);
+}
+
+void *speculation_worker(void *arg)
+{
+  speculation_t *spec = (speculation_t *) arg;
+  problem_t *problem = spec->problem;
+  solution_t *csolution = create_solution();
+  solver_ctx_t *ctx = create_solver_ctx();
+  lb_state_t *clb_state;
+  int ub;
+  uchar ret;
+
+  ctx->tlimit = spec->tlimit;
+  ctx->gap = spec->gap;
+  ctx->option = spec->ctx->option;
+  /* the pattern databases of the search running the iterations */
+  ctx->pdb = spec->ctx->pdb;
+  clb_state = create_search(ctx, problem);
+  ctx->speculation = spec;
+  ctx->depth_limit = spec->depth;
+  /* the improvements are shared as soon as they are found */
+  solver_ctx_set_callback(ctx, share_solution, (void *) spec);
+  ctx->n_node = ctx->count = 0;
+
+  while(True) {
+    pthread_mutex_lock(&(spec->mutex));
+    if(spec->time_limit == True || spec->next_ub >= spec->cutoff
+       || spec->best <= spec->proven_lb + spec->gap) {
+      pthread_mutex_unlock(&(spec->mutex));
+      break;
+    }
+    ub = spec->next_ub++;
+    ctx->stop_ub = max(ub, spec->proven_lb + spec->gap);
+    /* only the size of the incumbent is needed for bounding */
+    csolution->n_relocation = spec->best;
+    fprintf(stderr, (spec->depth > 0)?"probe=%d ":"cub=%d ", ub);
+    print_time(problem);
+    pthread_mutex_unlock(&(spec->mutex));
+
+    /* the previous iteration may leave the state modified */
+    initialize_state(problem, ctx->state);
+    ctx->depth_reached = False;
+    ret = bb(ctx, problem, csolution, &ub, clb_state, -1);
+
+    pthread_mutex_lock(&(spec->mutex));
+    if(ret == True) {
+      spec->cutoff = min(spec->cutoff, ub);
+    } else if(ret == Interrupted && ctx->depth_reached == True) {
+      spec->cutoff = min(spec->cutoff, ub);
+    } else if(ret == False) {
+      /* no solution with ub relocations or less */
+      spec->failed[ub] = True;
+      while(spec->failed[spec->proven_lb] == True) {
+        ++spec->proven_lb;
+      }
+      if(spec->depth == 0) {
+        report_iteration(spec->ctx, problem, ub, spec->proven_lb);
+      }
+    } else if(ret == TimeLimit) {
+      spec->time_limit = True;
+    }
+    pthread_mutex_unlock(&(spec->mutex));
+  }
+
+  pthread_mutex_lock(&(spec->mutex));
+  spec->n_node += ctx->n_node;
+  pthread_mutex_unlock(&(spec->mutex));
+
+  free_search(ctx);
+  free_solver_ctx(ctx);
+  free_solution(csolution);
+
+  return(NULL);
+}
+
+/*
+ * an improvement found by a thread of speculative search becomes the
+ * incumbent shared by the threads, and is reported to the search
+ * running them
+ *
+ */
+void share_solution(void *arg, problem_t *problem, solver_event_t *event)
+{
+  speculation_t *spec = (speculation_t *) arg;
+
+  if(event->type != SOLUTION_EVENT) {
+    return;
+  }
+
+  pthread_mutex_lock(&(spec->mutex));
+  if(event->solution->n_relocation < spec->solution->n_relocation) {
+    copy_solution(spec->solution, event->solution);
+    spec->best = spec->solution->n_relocation;
+    spec->cutoff = min(spec->cutoff, spec->best);
+    report_solution(spec->ctx, problem, spec->solution, event->source);
+  }
+  pthread_mutex_unlock(&(spec->mutex));
+}
+
+/*
+ * an improvement found on the permuted problem is reported with the
+ * stacks mapped back to the original order
+ *
+ */
+void restart_solution(void *arg, problem_t *problem, solver_event_t *event)
+{
+  int i;
+  restart_t *run = (restart_t *) arg;
+  solution_t *solution = run->solution;
+
+  if(event->type == SOLUTION_EVENT) {
+    if(event->solution->n_relocation >= run->best) {
+      /* found again after a restart */
+      return;
+    }
+    run->best = event->solution->n_relocation;
+    copy_solution(solution, event->solution);
+    for(i = 0; i < solution->n_relocation; ++i) {
+      solution->relocation[i].src = run->perm[solution->relocation[i].src];
+      solution->relocation[i].dst = run->perm[solution->relocation[i].dst];
+    }
+    event->solution = solution;
+  }
+
+  run->callback(run->callback_arg, run->problem, event);
+}
+#endif /* !PURE_BRANCH_AND_BOUND */
+
+/*
+ * report the improvement of solution found by source
+ *
+ */
+void report_solution(solver_ctx_t *ctx, problem_t *problem,
+                     solution_t *solution, char *source)
+{
+  solver_event_t event;
+
+  if(ctx->callback != NULL) {
+    event.type = SOLUTION_EVENT;
+    event.solution = solution;
+    event.source = source;
+    event.ub = solution->n_relocation;
+    event.lb = ctx->lb;
+    event.time = get_time(problem);
+    ctx->callback(ctx->callback_arg, problem, &event);
+  }
+}
+
+#ifndef PURE_BRANCH_AND_BOUND
+/*
+ * report that the iteration ub has failed, and raise the lower bound
+ * to lb
+ *
+ */
+void report_iteration(solver_ctx_t *ctx, problem_t *problem, int ub, int lb)
+{
+  solver_event_t event;
+
+  if(ctx->callback != NULL) {
+    event.type = ITERATION_EVENT;
+    event.solution = NULL;
+    event.source = NULL;
+    event.ub = ub;
+    event.lb = max(ctx->lb, lb);
+    event.time = get_time(problem);
+    ctx->callback(ctx->callback_arg, problem, &event);
+  }
+
+  report_bound(ctx, problem, lb);
+}
+#endif /* !PURE_BRANCH_AND_BOUND */
+
+/*
+ * raise the lower bound proven by the search to lb
+ *
+ */
+void report_bound(solver_ctx_t *ctx, problem_t *problem, int lb)
+{
+  solver_event_t event;
+
+  if(lb <= ctx->lb) {
+    return;
+  }
+  ctx->lb = lb;
+
+  if(ctx->callback != NULL) {
+    event.type = BOUND_EVENT;
+    event.solution = NULL;
+    event.source = NULL;
+    event.ub = 0;
+    event.lb = lb;
+    event.time = get_time(problem);
+    ctx->callback(ctx->callback_arg, problem, &event);
+  }
+}
+
+/*
+ * reserve the working area for problems with at most n_stack stacks,
+ * max_priority + 1 priorities and lb states of size ints
+ *
+ */
+void reserve_search(solver_ctx_t *ctx, int n_stack, int size,
+                    int max_priority)
+{
+  int n_relocation = MAX_N_RELOCATION + 1;
+  int max_n_child = n_stack*(n_stack - 1) + 1;
+
+  ctx->cap_n_stack = n_stack;
+  ctx->cap_size = size;
+  ctx->cap_max_priority = max_priority;
+
+  ctx->lb_state
+    = (lb_state_t **) malloc(n_relocation*sizeof(lb_state_t *));
+  ctx->lb_state[0] = (lb_state_t *) malloc(n_relocation*(max_n_child + 1)
+                                           *sizeof(lb_state_t));
+  ctx->lb_state[0][0].demand
+    = (int *) calloc((size_t) n_relocation*(max_n_child + 1)*size,
+                     sizeof(int));
+  ctx->lb_state[0][0].removal_for_supply
+    = (int **) malloc((size_t) n_relocation*(max_n_child + 1)
+                      *n_stack*sizeof(int *));
+
+  ctx->child_node
+    = (child_node_t **) malloc((size_t) n_relocation*sizeof(child_node_t *));
+  ctx->child_node[0] = (child_node_t *) malloc((size_t) n_relocation
+                                               *max_n_child
+                                               *sizeof(child_node_t));
+
+  ctx->stack_state
+    = (stack_state_t **) malloc((size_t) n_relocation*sizeof(stack_state_t *));
+  ctx->stack_state[0]
+    = (stack_state_t *) malloc((size_t) n_relocation*n_stack
+                               *sizeof(stack_state_t));
+
+#ifdef TYPE1
+  ctx->last_change_bw = (int *) malloc((size_t) 3*n_stack*sizeof(int));
+#else /* !TYPE1 */
+  ctx->last_change_bw
+    = (int *) malloc((size_t) (2*n_stack + n_relocation)*sizeof(int));
+#endif /* !TYPE1 */
+
+  ctx->last_priority_level
+    = (int **) malloc((size_t) (max_priority + 1)*sizeof(int *));
+  ctx->last_priority_level[0]
+    = (int *) malloc((size_t) (max_priority + 1)*n_stack*sizeof(int));
+
+  ctx->partial_solution = create_solution();
+
+  ctx->path = (search_node_t *) malloc((size_t) (n_relocation + 1)
+                                       *sizeof(search_node_t));
+
+#ifdef LOWER_BOUND2
+  ctx->lb2_cache
+    = (lb2_cache_t *) malloc((size_t) n_relocation*sizeof(lb2_cache_t));
+  ctx->lb2_cache[0].computed
+    = (uchar *) malloc((size_t) n_relocation*n_stack*n_stack*sizeof(uchar));
+  ctx->lb2_cache[0].relocation
+    = (int *) malloc((size_t) n_relocation*n_stack*n_stack*sizeof(int));
+#endif /* LOWER_BOUND2 */
+}
+
+/*
+ * lay out the working area of ctx for problem.  the area is reused
+ * if problem fits in it, and enlarged otherwise.
+ *
+ */
+void allocate_search(solver_ctx_t *ctx, problem_t *problem)
+{
+  int i, j, k;
+  int n_relocation = MAX_N_RELOCATION + 1;
+  int max_n_child = problem->n_stack*(problem->n_stack - 1) + 1;
+  int size = lb_state_size(problem);
+  lb_state_t **lb_state;
+  child_node_t **child_node;
+  stack_state_t **stack_state;
+  int **last_priority_level;
+#ifdef LOWER_BOUND2
+  lb2_cache_t *lb2_cache;
+#endif /* LOWER_BOUND2 */
+
+  if(ctx->n_stack == problem->n_stack && ctx->s_height == problem->s_height
+     && ctx->n_block == problem->n_block
+     && ctx->max_priority == problem->max_priority) {
+    return;
+  }
+
+  if(ctx->cap_n_stack == 0 || problem->n_stack > ctx->cap_n_stack
+     || size > ctx->cap_size || problem->max_priority > ctx->cap_max_priority) {
+    /* enlarged enough for the previous problems as well */
+    int cap_n_stack = max(ctx->cap_n_stack, problem->n_stack);
+    int cap_size = max(ctx->cap_size, size);
+    int cap_max_priority = max(ctx->cap_max_priority, problem->max_priority);
+
+    release_search(ctx);
+    reserve_search(ctx, cap_n_stack, cap_size, cap_max_priority);
+  } else if(ctx->n_stack > 0) {
+    free_state(ctx->state);
+  }
+
+  ctx->n_stack = problem->n_stack;
+  ctx->s_height = problem->s_height;
+  ctx->n_block = problem->n_block;
+  ctx->max_priority = problem->max_priority;
+
+  ctx->state = create_state(problem);
+
+  /* state for LB computation */
+  lb_state = ctx->lb_state;
+  for(i = 0; i < n_relocation; ++i) {
+    if(i > 0) {
+      lb_state[i] = lb_state[i - 1] + (max_n_child + 1);
+
+      lb_state[i][0].demand
+        = lb_state[i - 1][0].demand + (max_n_child + 1)*size;
+      lb_state[i][0].removal_for_supply
+        = lb_state[i - 1][0].removal_for_supply
+        + (max_n_child + 1)*problem->n_stack;
+    }      
+
+    lb_state[i][0].supply
+      = lb_state[i][0].demand + (problem->max_priority + 1);
+    lb_state[i][0].removal_for_supply[0]
+      = lb_state[i][0].supply + (problem->max_priority + 1);
+    for(k = 1; k < problem->n_stack; ++k) {
+      lb_state[i][0].removal_for_supply[k]
+      = lb_state[i][0].removal_for_supply[k - 1] + (problem->max_priority + 1);
+    }
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+    lb_state[i][0].removal_histogram
+      = lb_state[i][0].removal_for_supply[0]
+      + problem->n_stack*(problem->max_priority + 1);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
+    
+    for(j = 1; j < max_n_child + 1; ++j) {
+      lb_state[i][j].demand = lb_state[i][j - 1].demand + size;
+      lb_state[i][j].supply = lb_state[i][j - 1].supply + size;
+      lb_state[i][j].removal_for_supply
+        = lb_state[i][j - 1].removal_for_supply + problem->n_stack;
+      for(k = 0; k < problem->n_stack; ++k) {
+        lb_state[i][j].removal_for_supply[k]
+        = lb_state[i][j - 1].removal_for_supply[k] + size;
+      }
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_ALL
+      lb_state[i][j].removal_histogram
+        = lb_state[i][j - 1].removal_histogram + size;
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_ALL */
+    }
+  }
+
+  child_node = ctx->child_node;
+  stack_state = ctx->stack_state;
+  for(i = 1; i < n_relocation; ++i) {
+    child_node[i] = child_node[i - 1] + max_n_child;
+    stack_state[i] = stack_state[i - 1] + problem->n_stack;
+  }
+
+  /* for dominance check */
+  ctx->last_change_empty_bw = ctx->last_change_bw + problem->n_stack;
+  ctx->dominance_check = ctx->last_change_bw + 2*problem->n_stack;
+  /* used only if problem->duplicate == True */
+  last_priority_level = ctx->last_priority_level;
+  for(i = 1; i <= problem->max_priority; ++i) {
+    last_priority_level[i] = last_priority_level[i - 1] + problem->n_stack;
   }
-#endif /* !PURE_BRANCH_AND_BOUND */
 
-  if(tlimit > 0 && ++count == 200000) {
-    count = 0;
-    if(get_time(problem) >= (double) tlimit) {
-      return(TimeLimit);
-    }
+#ifdef LOWER_BOUND2
+  lb2_cache = ctx->lb2_cache;
+  for(i = 1; i < n_relocation; ++i) {
+    lb2_cache[i].computed = lb2_cache[i - 1].computed
+      + problem->n_stack*problem->n_stack;
+    lb2_cache[i].relocation = lb2_cache[i - 1].relocation
+      + problem->n_stack*problem->n_stack;
   }
+#endif /* LOWER_BOUND2 */
+}
 
-#if 0
-  printf("------\n");
-#ifdef PURE_BRANCH_AND_BOUND
-  printf("ub=%d, level=%d lb=%d lbGX=%d lbBX=%d\n", solution->n_relocation,
-         level, plb_state->lb, plb_state->lbGX, plb_state->lbBX);
-#else /* !PURE_BRANCH_AND_BOUND */
-  printf("ub=%d, level=%d lb=%d lbGX=%d lbBX=%d\n", *ub, level,
-         plb_state->lb, plb_state->lbGX, plb_state->lbBX);
-#endif /* !PURE_BRANCH_AND_BOUND */
-  print_state(problem, state, stderr);
-  print_solution_relocation(problem, partial_solution, stderr);
-#endif
+void release_search(solver_ctx_t *ctx)
+{
+  if(ctx->cap_n_stack == 0) {
+    return;
+  }
 
-  /* generate child nodes */
-#ifdef PURE_BRANCH_AND_BOUND
-  if((ret = bb_sub(problem, solution, plb_state, level, &n_child))
-     != False) {
-    return(ret);
+#ifdef LOWER_BOUND2
+  free(ctx->lb2_cache[0].relocation);
+  free(ctx->lb2_cache[0].computed);
+  free(ctx->lb2_cache);
+#endif /* LOWER_BOUND2 */
+  free(ctx->path);
+  free_solution(ctx->partial_solution);
+  free(ctx->last_priority_level[0]);
+  free(ctx->last_priority_level);
+  free(ctx->last_change_bw);
+  free(ctx->stack_state[0]);
+  free(ctx->stack_state);
+  free(ctx->child_node[0]);
+  free(ctx->child_node);
+  free(ctx->lb_state[0][0].removal_for_supply);
+  free(ctx->lb_state[0][0].demand);
+  free(ctx->lb_state[0]);
+  free(ctx->lb_state);
+  if(ctx->n_stack > 0) {
+    free_state(ctx->state);
   }
-#else /* !PURE_BRANCH_AND_BOUND */
-  if((ret = bb_sub(problem, solution, ub, plb_state, level, &n_child))
-     != False) {
-    return(ret);
+
+  ctx->n_stack = 0;
+  ctx->cap_n_stack = ctx->cap_size = ctx->cap_max_priority = 0;
+}
+
+/*
+ * set up the search of the problem on ctx and its working areas for
+ * the problem, and compute the lower bound of the initial state
+ *
+ */
+lb_state_t *create_search(solver_ctx_t *ctx, problem_t *problem)
+{
+#ifdef LOWER_BOUND2
+  int i;
+#endif /* LOWER_BOUND2 */
+  int max_n_child = problem->n_stack*(problem->n_stack - 1) + 1;
+  lb_state_t *clb_state;
+
+  allocate_search(ctx, problem);
+  initialize_state(problem, ctx->state);
+
+  if(ctx->pdb == NULL && ctx->option.n_pdb > 0) {
+    ctx->pdb = create_pdb(problem, ctx->option.n_pdb, ctx->option.pdb_dir);
+    ctx->own_pdb = True;
   }
-#endif /* !PURE_BRANCH_AND_BOUND */
 
-  /* branching */
-  for(k = 0; k < n_child; ++k) {
-    /* bounding (unnecessary) */
-#ifdef PURE_BRANCH_AND_BOUND
-    if(slb_state[cnode[k].index].lb + level >= solution->n_relocation) {
-      continue;
-    }
-#else /* !PURE_BRANCH_AND_BOUND */
-    if(slb_state[cnode[k].index].lb + level > *ub) {
-      continue;
-    }
+  /* working area for LB computation */
+  ctx->lb_work = create_lb_work(problem, ctx->pdb);
+  ctx->heuristics_work = create_heuristics_work(problem);
+
+  clb_state = &(ctx->lb_state[0][max_n_child]);
+
+  initialize_lb_state(problem, ctx->state, clb_state);
+
+  ctx->n_node = ctx->count = 0;
+  ctx->lb = 0;
+  ctx->speculation = NULL;
+  ctx->node_limit = 0;
+  ctx->depth = 0;
+#ifndef PURE_BRANCH_AND_BOUND
+  ctx->dfbnb_mode = False;
+  ctx->depth_limit = 0;
 #endif /* !PURE_BRANCH_AND_BOUND */
 
-    /* update the information for the child node */
-    i = cnode[k].src;
-    j = cnode[k].dst;
-    src_stack = stack[i];
-    dst_stack = stack[j];
-    block_state_backup = state->block_state[i][src_stack.n_tier];
+#ifdef LOWER_BOUND2
+  for(i = 0; i < MAX_N_RELOCATION + 1; ++i) {
+    ctx->lb2_cache[i].valid = False;
+  }
+  ctx->n_lb2 = ctx->n_lb2_cut = 0;
+#endif /* LOWER_BOUND2 */
 
-    reloc_block = state->block[i][stack[i].n_tier - 1];
-    state->block[j][stack[j].n_tier] = reloc_block;
-
-    stack[i] = stack_backup[i];
-    stack[j] = cnode[k].dst_stack;
-    state->n_misoverlay = cnode[k].n_misoverlay;
-
-    block_state = state->block_state[j];
-
-    if(stack[j].n_clean == stack[j].n_tier) {
-      block_state[stack[j].n_tier].misoverlay_priority = 0;
-      block_state[stack[j].n_tier].upside_down = False;
-    } else if(stack[j].n_clean + 1 == stack[j].n_tier) {
-      block_state[stack[j].n_tier].misoverlay_priority = reloc_block.priority;
-      block_state[stack[j].n_tier].upside_down = True;
-    } else if(reloc_block.priority
-              >= block_state[stack[j].n_tier - 1].misoverlay_priority) {
-      block_state[stack[j].n_tier].misoverlay_priority = reloc_block.priority;
-      block_state[stack[j].n_tier].upside_down
-        = block_state[stack[j].n_tier - 1].upside_down;
-    } else {
-      block_state[stack[j].n_tier].misoverlay_priority
-        = block_state[stack[j].n_tier - 1].misoverlay_priority;
-      block_state[stack[j].n_tier].upside_down = False;
-    }
+#ifdef ADAPTIVE_LOWER_BOUND
+  memset((void *) ctx->lb_statistics, 0, sizeof(ctx->lb_statistics));
+  memset((void *) ctx->n_lb_skip, 0, sizeof(ctx->n_lb_skip));
+#endif /* ADAPTIVE_LOWER_BOUND */
 
-    /* update the partial solution */
-    partial_solution->n_relocation = level - 1;
-    add_relocation(partial_solution, i, j, &reloc_block);
+  if(ctx->option.endgame_threshold > 0) {
+    ctx->endgame = create_endgame(problem);
+  }
 
-    last_change = state->last_relocation[reloc_block.no];
-    state->last_relocation[reloc_block.no] = level;
+  if(ctx->option.flow_depth > 0) {
+    ctx->flow = create_flow(problem);
+  }
 
-#ifdef PURE_BRANCH_AND_BOUND
-    if((ret = bb(problem, solution, &(slb_state[cnode[k].index]),
-                 level + 1)) != False) {
-      break;
+  if(ctx->state->n_misoverlay > 0) {
+    lower_bound(ctx->lb_work, problem, ctx->state, clb_state,
+                MAX_N_RELOCATION, False);
+    if(ctx->flow != NULL) {
+      /* assignment relaxation at the root node */
+      clb_state->lb
+        = max(clb_state->lb,
+              flow_lower_bound(ctx->flow, problem, ctx->state, clb_state));
     }
-#else /* !PURE_BRANCH_AND_BOUND */
-    if((ret = bb(problem, solution, ub, &(slb_state[cnode[k].index]),
-                 level + 1)) != False) {
-      /* an optimal solution is found, or the time limit is reached */
-      break;
-    }
-#endif /* !PURE_BRANCH_AND_BOUND */
-
-    stack[i] = src_stack;
-    stack[j] = dst_stack;
-    state->block_state[i][src_stack.n_tier] = block_state_backup;
-    
-    state->last_relocation[reloc_block.no] = last_change;
-    state->n_misoverlay = n_misoverlay;
-    state->block[i][stack[i].n_tier - 1] = reloc_block;
   }
 
-  return(ret);
+  return(clb_state);
+}
+
+/*
+ * free the working areas of the search on ctx that depend on its
+ * problem (the others are kept for the next search)
+ *
+ */
+void free_search(solver_ctx_t *ctx)
+{
+  free_endgame(ctx->endgame);
+  free_flow(ctx->flow);
+  free_lb_work(ctx->lb_work);
+  free_heuristics_work(ctx->heuristics_work);
+  if(ctx->own_pdb == True) {
+    free_pdb(ctx->pdb);
+  }
+  ctx->endgame = NULL;
+  ctx->flow = NULL;
+  ctx->lb_work = NULL;
+  ctx->heuristics_work = NULL;
+  ctx->pdb = NULL;
+  ctx->own_pdb = False;
 }
 
 #ifdef PURE_BRANCH_AND_BOUND
-uchar bb_sub(problem_t *problem, solution_t *solution, lb_state_t *plb_state,
-             int level, int *n_child)
-#else /* !PURE_BRANCH_AND_BOUND */
-uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
+uchar bb_sub(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
              lb_state_t *plb_state, int level, int *n_child)
+#else /* !PURE_BRANCH_AND_BOUND */
+uchar bb_sub(solver_ctx_t *ctx, problem_t *problem, solution_t *solution,
+             int *ub, lb_state_t *plb_state, int level, int *n_child)
 #endif /* !PURE_BRANCH_AND_BOUND */
 {
 #ifdef BEST_FIRST
@@ -467,23 +2093,32 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
   int *pdominance_table;
 #endif /* !TYPE1 */
   int src_level, dst_level;
+#ifndef PURE_BRANCH_AND_BOUND
+  int cost;
+#endif /* !PURE_BRANCH_AND_BOUND */
   uchar check_flag = (problem->duplicate == True && level >= 2);
+  state_t *state = ctx->state;
+  solution_t *partial_solution = ctx->partial_solution;
+  int *last_change_bw = ctx->last_change_bw;
+  int *last_change_empty_bw = ctx->last_change_empty_bw;
+  int *dominance_check = ctx->dominance_check;
+  int **last_priority_level = ctx->last_priority_level;
   stack_state_t *stack = state->stack;
   /* stack state backup */
-  stack_state_t *stack_backup = stack_state[level];
+  stack_state_t *stack_backup = ctx->stack_state[level];
   stack_state_t src_stack, dst_stack;
   /* current state */
-  lb_state_t *slb_state = &(lb_state[level][0]);
+  lb_state_t *slb_state = &(ctx->lb_state[level][0]);
   /* current */
   lb_state_t *clb_state = slb_state;
   /* backup */
-  lb_state_t *blb_state = &(lb_state[level][max_n_child]);
+  lb_state_t *blb_state = &(ctx->lb_state[level][max_n_child]);
   /* child nodes */
-  child_node_t *cnode = child_node[level];
+  child_node_t *cnode = ctx->child_node[level];
 
 #ifdef TYPE1
   memset((void *) dominance_check, 0, (size_t) problem->n_stack*sizeof(int));
-  preloc[0].src = preloc[1].src = preloc[2].src = -1;
+  ctx->preloc[0].src = ctx->preloc[1].src = ctx->preloc[2].src = -1;
 #else /* !TYPE1 */
   dominance_check[level - 1] = 0;
 #endif /* !TYPE1 */
@@ -496,29 +2131,32 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
         last_change = - stack[i].last_change;
         dst = partial_solution->relocation[last_change - 1].dst;
         if(stack[dst].last_change == last_change) {
-          if(i > preloc[0].src) {
-            preloc[2] = preloc[1];
-            preloc[1] = preloc[0];
-            preloc[0].src = i;
-            preloc[0].dst = dst;
-          } else if(i > preloc[1].src) {
-            preloc[2] = preloc[1];
-            preloc[1].src = i;
-            preloc[1].dst = dst;
-          } else if(i > preloc[2].src) {
-            preloc[2].src = i;
-            preloc[2].dst = dst;
+          if(i > ctx->preloc[0].src) {
+            ctx->preloc[2] = ctx->preloc[1];
+            ctx->preloc[1] = ctx->preloc[0];
+            ctx->preloc[0].src = i;
+            ctx->preloc[0].dst = dst;
+          } else if(i > ctx->preloc[1].src) {
+            ctx->preloc[2] = ctx->preloc[1];
+            ctx->preloc[1].src = i;
+            ctx->preloc[1].dst = dst;
+          } else if(i > ctx->preloc[2].src) {
+            ctx->preloc[2].src = i;
+            ctx->preloc[2].dst = dst;
           }
         }
       }
     }
 
-    if(preloc[0].src >= 0) {
-      dominance_check[preloc[0].src] = dominance_check[preloc[0].dst] = 1;
-      if(preloc[1].src >= 0) {
-        dominance_check[preloc[1].src] = dominance_check[preloc[1].dst] = 2;
-        if(preloc[2].src >= 0) {
-          dominance_check[preloc[2].src] = dominance_check[preloc[2].dst] = 3;
+    if(ctx->preloc[0].src >= 0) {
+      dominance_check[ctx->preloc[0].src]
+        = dominance_check[ctx->preloc[0].dst] = 1;
+      if(ctx->preloc[1].src >= 0) {
+        dominance_check[ctx->preloc[1].src]
+          = dominance_check[ctx->preloc[1].dst] = 2;
+        if(ctx->preloc[2].src >= 0) {
+          dominance_check[ctx->preloc[2].src]
+            = dominance_check[ctx->preloc[2].dst] = 3;
         }
       }
     }
@@ -574,10 +2212,12 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
     int min_dst_stack = 0;
     uchar empty_stack = False;
 
-    last_change = ABS(stack[i - 1].last_change);
-    if(i > 0 && stack[i - 1].n_tier < problem->s_height
-       && last_change < last_change_fw) {
-      last_change_fw = last_change;
+    if(i > 0) {
+      last_change = ABS(stack[i - 1].last_change);
+      if(stack[i - 1].n_tier < problem->s_height
+         && last_change < last_change_fw) {
+        last_change_fw = last_change;
+      }
     }
 
     if(stack[i].n_tier == 0) {
@@ -659,6 +2299,9 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
     /* update the state of the source stack */
     lb_flag_src = update_state_src(problem, state, blb_state, i, level);
     stack_backup[i] = stack[i];
+#ifdef LOWER_BOUND2
+    ctx->lb2_cache[level].valid = False;
+#endif /* LOWER_BOUND2 */
 
     /* enumerate the candidates for the destination stack */
     for(j = min_dst_stack; j < problem->n_stack; ++j) {
@@ -686,7 +2329,7 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
       }
 
 #ifdef TYPE1
-      if(i < preloc[pdominance_table[dominance_check[j]]].src) {
+      if(i < ctx->preloc[pdominance_table[dominance_check[j]]].src) {
         /* x => y, ..., z => u */
         /* x, y are unchanged during "...", z < x */
         /* ..., z =>u, x => y dominates x => y, ..., z => u */
@@ -753,30 +2396,38 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
         copy_solution(solution, partial_solution);
         fprintf(stderr, "ub=%d ", solution->n_relocation);
         print_time(problem);
+        report_solution(ctx, problem, solution, "search");
 
 #ifdef PURE_BRANCH_AND_BOUND
         state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
         stack[j] = dst_stack;
         continue;
 #else /* !PURE_BRANCH_AND_BOUND */
+        if(ctx->dfbnb_mode == True && solution->n_relocation > ctx->stop_ub) {
+          /* tighten the bound and continue */
+          *ub = solution->n_relocation - 1 - ctx->gap;
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
         return(True);
 #endif /* !PURE_BRANCH_AND_BOUND */
       }
 
       /* lower bound */
 #ifdef PURE_BRANCH_AND_BOUND
-      lower_bound(problem, state, clb_state,
+      lower_bound(ctx->lb_work, problem, state, clb_state,
                   solution->n_relocation - level - 1,
                   (lb_flag_src && lb_flag_dst));
 #else /* !PURE_BRANCH_AND_BOUND */
-      lower_bound(problem, state, clb_state,  *ub - level,
+      lower_bound(ctx->lb_work, problem, state, clb_state,  *ub - level,
                   (lb_flag_src && lb_flag_dst));
 #endif /* !PURE_BRANCH_AND_BOUND */
 
-      ++n_node;
+      ++ctx->n_node;
 
 #if 0
-      if(n_node > 1U<<30) {
+      if(ctx->n_node > 1U<<30) {
         print_time(problem);
         exit(1);
       }
@@ -791,7 +2442,7 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
         continue;
       }
 #else /* !PURE_BRANCH_AND_BOUND */
-      if(clb_state->lb + level > *ub) {
+      if(WEIGHTED_LB(ctx, clb_state->lb) + level > *ub) {
         /* recover the state */
         state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
         stack[j] = dst_stack;
@@ -799,28 +2450,115 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
       }
 #endif /* !PURE_BRANCH_AND_BOUND */
 
-#ifdef LOWER_BOUND2
-      lower_bound2(problem, state, clb_state);
+#ifdef PURE_BRANCH_AND_BOUND
+      if(level <= ctx->option.flow_depth
+         && clb_state->lb + level == solution->n_relocation - 1
+         && SELECT_LOWER_BOUND(ctx, FLOW_BOUND, level)) {
+#else /* !PURE_BRANCH_AND_BOUND */
+      if(level <= ctx->option.flow_depth
+         && WEIGHTED_LB(ctx, clb_state->lb) + level == *ub
+         && SELECT_LOWER_BOUND(ctx, FLOW_BOUND, level)) {
+#endif /* !PURE_BRANCH_AND_BOUND */
+        /* assignment relaxation near the root, */
+        /* only when it can cut off the node */
+        clb_state->lb
+          = max(clb_state->lb,
+                flow_lower_bound(ctx->flow, problem, state, clb_state));
 
-      /* bounding */
+        /* bounding */
 #ifdef PURE_BRANCH_AND_BOUND
-      if(clb_state->lb + level >= solution->n_relocation) {
-        /* recover the state */
-        state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
-        stack[j] = dst_stack;
-        continue;
-      }
+        RECORD_LOWER_BOUND(ctx, FLOW_BOUND, level,
+                           clb_state->lb + level >= solution->n_relocation);
+        if(clb_state->lb + level >= solution->n_relocation) {
+          /* recover the state */
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
 #else /* !PURE_BRANCH_AND_BOUND */
-      if(clb_state->lb + level > *ub) {
-        /* recover the state */
-        state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
-        stack[j] = dst_stack;
-        continue;
+        RECORD_LOWER_BOUND(ctx, FLOW_BOUND, level,
+                           WEIGHTED_LB(ctx, clb_state->lb) + level > *ub);
+        if(WEIGHTED_LB(ctx, clb_state->lb) + level > *ub) {
+          /* recover the state */
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
+#endif /* !PURE_BRANCH_AND_BOUND */
       }
+
+#ifdef LOWER_BOUND2
+      /* the second lower bound is evaluated only when the node */
+      /* is at the threshold */
+#ifdef PURE_BRANCH_AND_BOUND
+      if(clb_state->lb + level == solution->n_relocation - 1
+         && SELECT_LOWER_BOUND(ctx, SECOND_BOUND, level)) {
+#else /* !PURE_BRANCH_AND_BOUND */
+      if(WEIGHTED_LB(ctx, clb_state->lb) + level == *ub
+         && SELECT_LOWER_BOUND(ctx, SECOND_BOUND, level)) {
 #endif /* !PURE_BRANCH_AND_BOUND */
+        ++ctx->n_lb2;
+        lower_bound2(problem, state, clb_state, &(ctx->lb2_cache[level]), j);
 
+        /* bounding */
+#ifdef PURE_BRANCH_AND_BOUND
+        RECORD_LOWER_BOUND(ctx, SECOND_BOUND, level,
+                           clb_state->lb + level >= solution->n_relocation);
+        if(clb_state->lb + level >= solution->n_relocation) {
+          /* recover the state */
+          ++ctx->n_lb2_cut;
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
+#else /* !PURE_BRANCH_AND_BOUND */
+        RECORD_LOWER_BOUND(ctx, SECOND_BOUND, level,
+                           WEIGHTED_LB(ctx, clb_state->lb) + level > *ub);
+        if(WEIGHTED_LB(ctx, clb_state->lb) + level > *ub) {
+          /* recover the state */
+          ++ctx->n_lb2_cut;
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
+#endif /* !PURE_BRANCH_AND_BOUND */
+      }
 #endif /* LOWER_BOUND2 */
 
+#ifndef PURE_BRANCH_AND_BOUND
+      if(state->n_misoverlay <= ctx->option.endgame_threshold
+         && (cost = endgame(ctx->endgame, problem, state, clb_state->lb,
+                            *ub - level)) >= 0) {
+        /* the exact cost of the endgame replaces the lower bound */
+        if(cost + level > *ub) {
+          /* recover the state */
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
+
+        /* solved */
+        partial_solution->n_relocation = level - 1;
+        add_relocation(partial_solution, i, j, &reloc_block);
+        endgame_solution(ctx->endgame, problem, state, cost,
+                         partial_solution);
+
+        copy_solution(solution, partial_solution);
+        fprintf(stderr, "ub=%d endgame=%d ", solution->n_relocation, cost);
+        print_time(problem);
+        report_solution(ctx, problem, solution, "endgame");
+
+        if(ctx->dfbnb_mode == True && solution->n_relocation > ctx->stop_ub) {
+          /* tighten the bound and continue */
+          *ub = solution->n_relocation - 1 - ctx->gap;
+          state->n_misoverlay -= 1 + dst_stack.n_clean - stack[j].n_clean;
+          stack[j] = dst_stack;
+          continue;
+        }
+        return(True);
+      }
+#endif /* !PURE_BRANCH_AND_BOUND */
+
 #ifdef HEURISTICS
       if(clb_state->n_dirty_stack + clb_state->n_full_clean_stack
          < problem->n_stack) {
@@ -830,18 +2568,21 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
         partial_solution->n_relocation = level - 1;
         add_relocation(partial_solution, i, j, &reloc_block);
 
-        if(heuristics(problem, state, partial_solution,
+        if(heuristics(ctx->heuristics_work, problem, state, partial_solution,
                       solution->n_relocation)) {
           /* better upper bound is found */
           copy_solution(solution, partial_solution);
           fprintf(stderr, "ub=%d depth=%d ", solution->n_relocation,
                   level);
           print_time(problem);
+          report_solution(ctx, problem, solution, "heuristics");
 #ifndef PURE_BRANCH_AND_BOUND
-          if(solution->n_relocation <= *ub) {
-            /* When a solution as good as *ub is found, */
+          if(solution->n_relocation <= ctx->stop_ub) {
+            /* When a solution as good as stop_ub is found, */
             /* the search is terminated */
             return(True);
+          } else if(ctx->dfbnb_mode == True) {
+            *ub = solution->n_relocation - 1 - ctx->gap;
           }
 #endif /* !PURE_BRANCH_AND_BOUND */
         }
@@ -907,12 +2648,160 @@ uchar bb_sub(problem_t *problem, solution_t *solution, int *ub,
   return(False);
 }
 
+#ifdef ADAPTIVE_LOWER_BOUND
+/*
+ * whether the bound is evaluated at a node of the level at the threshold:
+ * it is skipped if it has cut off less than one of lb_cost[bound]
+ * evaluations in the depth band, except for probing
+ *
+ */
+uchar select_lower_bound(solver_ctx_t *ctx, int bound, int level)
+{
+  lb_statistics_t *statistics
+    = &(ctx->lb_statistics[bound][min(level/LB_BAND_WIDTH, LB_N_BAND - 1)]);
+
+  if(statistics->n_evaluation < LB_WARMUP
+     || statistics->n_cutoff*lb_cost[bound] >= statistics->n_evaluation
+     || ++statistics->n_skip >= LB_PROBE) {
+    statistics->n_skip = 0;
+    return(True);
+  }
+
+  ++ctx->n_lb_skip[bound];
+  return(False);
+}
+
+void record_lower_bound(solver_ctx_t *ctx, int bound, int level,
+                        uchar cutoff)
+{
+  lb_statistics_t *statistics
+    = &(ctx->lb_statistics[bound][min(level/LB_BAND_WIDTH, LB_N_BAND - 1)]);
+
+  ++statistics->n_evaluation;
+  if(cutoff == True) {
+    ++statistics->n_cutoff;
+  }
+
+  if(statistics->n_evaluation >= LB_WINDOW) {
+    /* older evaluations are forgotten gradually */
+    statistics->n_evaluation /= 2;
+    statistics->n_cutoff /= 2;
+  }
+}
+#endif /* ADAPTIVE_LOWER_BOUND */
+
+/*
+ * working area for lower_bound() on problem (used by one thread at a
+ * time).  the pattern databases pdb (NULL: not used) are only read, and
+ * may be shared by the working areas
+ *
+ */
+lb_work_t *create_lb_work(problem_t *problem, pdb_t *pdb)
+{
+  lb_work_t *work = (lb_work_t *) malloc(sizeof(lb_work_t));
+
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_DP
+  work->table
+    = (int *) malloc((problem->s_height*problem->n_stack + 1)*sizeof(int));
+  work->bits = (ulint *) malloc((problem->s_height*problem->n_stack + 1)
+                                *(problem->n_stack + 1)*sizeof(ulint));
+#else /* !IMPROVED_BF_LOWER_BOUND_BY_DP */
+  work->table = (int *) malloc((problem->s_height + 1)*sizeof(int));
+#endif /* !IMPROVED_BF_LOWER_BOUND_BY_DP */
+  work->pdb = pdb;
+
+  return(work);
+}
+
+void free_lb_work(lb_work_t *work)
+{
+  if(work != NULL) {
+    free(work->table);
+#ifdef IMPROVED_BF_LOWER_BOUND_BY_DP
+    free(work->bits);
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_DP */
+    free(work);
+  }
+}
+
+#if defined(IMPROVED_BF_LOWER_BOUND_BY_DP) \
+  && !defined(IMPROVED_BF_LOWER_BOUND_BY_ALL)
+/*
+ * the set of slot numbers bits + n (numbers not less than surplus are
+ * merged into surplus)
+ *
+ */
+static ulint saturated_shift(ulint bits, int n, int surplus)
+{
+  ulint goal = 1ULL << surplus;
+
+  if(bits == 0) {
+    return(0);
+  } else if(n >= surplus) {
+    return(goal);
+  }
+
+  return(((bits << n) & (goal - 1)) | ((bits >> (surplus - n))?goal:0));
+}
+
+/*
+ * nGX by DP on bitsets: the minimum number of relocations to make
+ * surplus slots in the stacks whose clean priority is less than priority
+ * (surplus < 64).  lb_bits[c*(n + 1) + i]: the slot numbers made by c
+ * relocations in the first i stacks.  the cost c is increased until the
+ * surplus is covered or c exceeds max_cost (then max_cost + 1 suffices
+ * for pruning)
+ *
+ */
+static int lower_bound_by_dp(lb_work_t *work, problem_t *problem,
+                             state_t *cstate, lb_state_t *clb_state,
+                             int priority, int surplus, int max_cost)
+{
+  int i, k, c, n = 0;
+  int *n_removal = work->table, *n_slot = work->table + problem->n_stack;
+  ulint goal = 1ULL << surplus, bits, *row, *lb_bits = work->bits;
+  stack_state_t *stack = cstate->stack;
+
+  for(i = 0; i < problem->n_stack; ++i) {
+    if(stack[i].clean_priority < priority) {
+      n_removal[n] = clb_state->removal_for_supply[i][priority];
+      n_slot[n] = problem->s_height - stack[i].n_clean + n_removal[n];
+      ++n;
+    }
+  }
+
+  if(max_cost > problem->s_height*problem->n_stack) {
+    max_cost = problem->s_height*problem->n_stack;
+  }
+
+  for(c = 0; c <= max_cost; ++c) {
+    row = lb_bits + c*(n + 1);
+    row[0] = (c == 0)?1:0;
+    for(i = 0; i < n; ++i) {
+      bits = row[i];
+      /* n_slot[i] + k slots by n_removal[i] + k relocations */
+      for(k = 0; k <= problem->s_height - n_slot[i] && n_removal[i] + k <= c;
+          ++k) {
+        bits |= saturated_shift(lb_bits[(c - n_removal[i] - k)*(n + 1) + i],
+                                n_slot[i] + k, surplus);
+      }
+      row[i + 1] = bits;
+    }
+    if(row[n] & goal) {
+      return(c);
+    }
+  }
+
+  return(max_cost + 1);
+}
+#endif /* IMPROVED_BF_LOWER_BOUND_BY_DP && !IMPROVED_BF_LOWER_BOUND_BY_ALL */
+
 /*
  * Bortfeldt and Forster (2012)
  *
  */
-int lower_bound(problem_t *problem, state_t *cstate, lb_state_t *clb_state,
-                int upper_bound, uchar flag)
+int lower_bound(lb_work_t *work, problem_t *problem, state_t *cstate,
+                lb_state_t *clb_state, int upper_bound, uchar flag)
 {
   int i;
 #ifdef IMPROVED_BF_LOWER_BOUND1
@@ -974,21 +2863,15 @@ int lower_bound(problem_t *problem, state_t *cstate, lb_state_t *clb_state,
       if(surplus > 0 && surplus > max_surplus) {
         /* make space in n stacks */
         int n = (surplus + problem->s_height - 1)/problem->s_height;
-
-        memset((void *) lb_work, 0, (problem->s_height + 1)*sizeof(int));
-
-        for(j = 0; j < problem->n_stack; ++j) {
-          if(stack[j].clean_priority < i) {
-            /* necessary relocations for accepting demand surplus */
-            /* lb_work[i]: the number of stacks such that i blocks */
-            /* should be relocated in order to accept demand surplus */
-            ++lb_work[clb_state->removal_for_supply[j][i]];
-          }
-        }
+        /* necessary relocations for accepting demand surplus */
+        /* histogram[j]: the number of stacks such that j blocks */
+        /* should be relocated in order to accept demand surplus */
+        int *histogram
+          = clb_state->removal_histogram + i*(problem->s_height + 1);
 
         clb_state->lbGX = 0;
-        for(j = 1; n > 0 && j < problem->s_height; n -= lb_work[j], ++j) {
-          clb_state->lbGX += j*min(n, lb_work[j]);
+        for(j = 1; n > 0 && j < problem->s_height; n -= histogram[j], ++j) {
+          clb_state->lbGX += j*min(n, histogram[j]);
         }
         if(max_lbGX < clb_state->lbGX) {
           max_lbGX = clb_state->lbGX;
@@ -1005,6 +2888,7 @@ int lower_bound(problem_t *problem, state_t *cstate, lb_state_t *clb_state,
     int max_misoverlay_priority = -1;
 #endif /* IMPROVED_BF_LOWER_BOUND3 */
     int priority = -1;
+    int *lb_work = work->table;
 
     clb_state->lbGX = 0;
 #ifdef IMPROVED_BF_LOWER_BOUND3
@@ -1034,38 +2918,44 @@ int lower_bound(problem_t *problem, state_t *cstate, lb_state_t *clb_state,
     if(max_surplus > 0) {
       /* make space in n stacks */
 #ifdef IMPROVED_BF_LOWER_BOUND_BY_DP
-      memset((void *) lb_work, 0,
-             (problem->s_height*problem->n_stack + 1)*sizeof(int));
+      if(max_surplus < (int) (8*sizeof(ulint))) {
+        clb_state->lbGX
+          = lower_bound_by_dp(work, problem, cstate, clb_state, priority,
+                              max_surplus, upper_bound - clb_state->lbBX);
+      } else {
+        memset((void *) lb_work, 0,
+               (problem->s_height*problem->n_stack + 1)*sizeof(int));
 
-      lb_work[0] = 1;
-      for(i = 0; i < problem->n_stack; ++i) {
-        if(stack[i].clean_priority < priority) {
-          int j, k;
-          int n_removal = clb_state->removal_for_supply[i][priority];
-          int n_slot = problem->s_height - stack[i].n_clean + n_removal;
-
-          for(j = max_surplus - 1; j >= 0; --j) {
-            if(lb_work[j] > 0) {
-              for(k = 0; k <= problem->s_height - n_slot; ++k) {
-                if(lb_work[j + n_slot + k] == 0) {
-                  lb_work[j + n_slot + k] = lb_work[j] + n_removal + k;
-                } else {
-                  lb_work[j + n_slot + k]
-                    = min(lb_work[j + n_slot + k], lb_work[j] + n_removal + k);
+        lb_work[0] = 1;
+        for(i = 0; i < problem->n_stack; ++i) {
+          if(stack[i].clean_priority < priority) {
+            int j, k;
+            int n_removal = clb_state->removal_for_supply[i][priority];
+            int n_slot = problem->s_height - stack[i].n_clean + n_removal;
+
+            for(j = max_surplus - 1; j >= 0; --j) {
+              if(lb_work[j] > 0) {
+                for(k = 0; k <= problem->s_height - n_slot; ++k) {
+                  if(lb_work[j + n_slot + k] == 0) {
+                    lb_work[j + n_slot + k] = lb_work[j] + n_removal + k;
+                  } else {
+                    lb_work[j + n_slot + k] = min(lb_work[j + n_slot + k],
+                                                  lb_work[j] + n_removal + k);
+                  }
                 }
               }
             }
           }
         }
-      }
-      
-      clb_state->lbGX = problem->n_block;
-      for(i = max_surplus; i < max_surplus + problem->s_height; ++i) {
-        if(lb_work[i] > 0 && clb_state->lbGX > lb_work[i]) {
-          clb_state->lbGX = lb_work[i];
+
+        clb_state->lbGX = problem->n_block;
+        for(i = max_surplus; i < max_surplus + problem->s_height; ++i) {
+          if(lb_work[i] > 0 && clb_state->lbGX > lb_work[i]) {
+            clb_state->lbGX = lb_work[i];
+          }
         }
+        --clb_state->lbGX;
       }
-      --clb_state->lbGX;
 #else /* !IMPROVED_BF_LOWER_BOUND_BY_DP */
       int n = (max_surplus + problem->s_height - 1)/problem->s_height;
 #ifdef IMPROVED_BF_LOWER_BOUND3
@@ -1306,16 +3196,26 @@ int lower_bound(problem_t *problem, state_t *cstate, lb_state_t *clb_state,
   clb_state->lb += lb_increment;
 #endif /* IMPROVED_BF_LOWER_BOUND2 */
 
+  if(work->pdb != NULL && clb_state->lb <= upper_bound) {
+    /* pattern databases */
+    clb_state->lb = max(clb_state->lb,
+                        pdb_lower_bound(work->pdb, problem, cstate));
+  }
+
   return(clb_state->lb);
 }
 
 #ifdef LOWER_BOUND2
-int lower_bound2(problem_t *problem, state_t *cstate, lb_state_t *clb_state)
+/* the terms for the pairs of stacks other than dst are taken from */
+/* cache (if not NULL), which is valid for the children of a source stack */
+int lower_bound2(problem_t *problem, state_t *cstate, lb_state_t *clb_state,
+                 lb2_cache_t *cache, int dst)
 {
-  int i, j, k, l;
+  int i, j, k;
   int min_relocation = problem->s_height;
   int max_clean_priority = -1;
-  int misoverlay_priority;
+  int extra_relocation = clb_state->lbBX - cstate->n_misoverlay;
+  uchar all_dirty = (clb_state->n_dirty_stack == problem->n_stack);
   stack_state_t *stack = cstate->stack;
 
   for(i = 0; i < problem->n_stack; ++i) {
@@ -1324,79 +3224,111 @@ int lower_bound2(problem_t *problem, state_t *cstate, lb_state_t *clb_state)
     }
   }
 
-  if(clb_state->n_dirty_stack == problem->n_stack) {
-    /* all the stacks are dirty */
-    for(i = 0; i < problem->n_stack; ++i) {
-      misoverlay_priority = stack[i].misoverlay_priority;
-
-      for(j = 0; j < problem->n_stack; ++j) {
-        k = clb_state->removal_for_supply[j][misoverlay_priority];
-        l = 0;
-        if(stack[j].n_clean > k
-           && cstate->block[j][stack[j].n_clean - k - 1].priority
-           > max_clean_priority) {
-          l = 1;
-        }
-          
-        if(i == j) {
-          if(stack[j].n_tier - stack[j].n_clean
-             > clb_state->lbBX - cstate->n_misoverlay) {
-            ++l;
-          }
-        } else if(stack[j].misoverlay_priority > max_clean_priority) {
-          l = 1;
-        }
-
-        if(min_relocation > k + l) {
-          min_relocation = k + l;
-          if(clb_state->lbBX + min_relocation < clb_state->lb) {
-            i = problem->n_stack - 1;
-            break;
-          }
-        }
-      }
-    }
+  if(cache != NULL
+     && (cache->valid == False || cache->all_dirty != all_dirty
+         || cache->max_clean_priority != max_clean_priority
+         || (all_dirty == True
+             && cache->extra_relocation != extra_relocation))) {
+    /* the terms depend on these values */
+    memset((void *) cache->computed, 0,
+           (size_t) problem->n_stack*problem->n_stack*sizeof(uchar));
+    cache->valid = True;
+    cache->all_dirty = all_dirty;
+    cache->max_clean_priority = max_clean_priority;
+    cache->extra_relocation = extra_relocation;
+  }
 
-    min_relocation += clb_state->lbBX - cstate->n_misoverlay;
-    clb_state->lb = max(clb_state->lb, cstate->n_misoverlay + min_relocation);
-  } else {
-    for(i = 0; i < problem->n_stack; ++i) {
+  for(i = 0; i < problem->n_stack; ++i) {
+    if(all_dirty == False) {
       if(stack[i].n_tier == 0) {
         min_relocation = 0;
         break;
+      } else if(stack[i].misoverlay_priority <= 0) {
+        continue;
       }
+    }
 
-      misoverlay_priority = stack[i].misoverlay_priority;
-      if(misoverlay_priority > 0) {
-        for(j = 0; j < problem->n_stack; ++j) {
-          k = clb_state->removal_for_supply[j][misoverlay_priority];
-          if(i != j && stack[j].n_clean < stack[j].n_tier
-             && stack[i].misoverlay_priority > max_clean_priority) {
-            ++k;
-          } else if(stack[j].n_clean > k
-                    && cstate->block[j][stack[j].n_clean - k - 1].priority
-                    > max_clean_priority) {
-            ++k;
-          }
-
-          if(i == j) {
-            ++k;
-          }
+    for(j = 0; j < problem->n_stack; ++j) {
+      if(cache != NULL && i != dst && j != dst) {
+        if(cache->computed[i*problem->n_stack + j] == False) {
+          cache->computed[i*problem->n_stack + j] = True;
+          cache->relocation[i*problem->n_stack + j]
+            = lower_bound2_pair(problem, cstate, clb_state, i, j,
+                                max_clean_priority, all_dirty);
+        }
+        k = cache->relocation[i*problem->n_stack + j];
+      } else {
+        k = lower_bound2_pair(problem, cstate, clb_state, i, j,
+                              max_clean_priority, all_dirty);
+      }
 
-          if(min_relocation > k) {
-            min_relocation = k;
-            if(cstate->n_misoverlay + min_relocation < clb_state->lb) {
-              i = problem->n_stack - 1;
-              break;
-            }
-          }
+      if(min_relocation > k) {
+        min_relocation = k;
+        if((all_dirty == True
+            && clb_state->lbBX + min_relocation < clb_state->lb)
+           || (all_dirty == False
+               && cstate->n_misoverlay + min_relocation < clb_state->lb)) {
+          /* no improvement */
+          i = problem->n_stack - 1;
+          break;
         }
       }
     }
+  }
 
-    clb_state->lb = max(clb_state->lb, cstate->n_misoverlay + min_relocation);
+  if(all_dirty == True) {
+    min_relocation += extra_relocation;
   }
+  clb_state->lb = max(clb_state->lb, cstate->n_misoverlay + min_relocation);
 
   return(cstate->n_misoverlay + min_relocation);
 }
+
+/* relocations necessary to place the misoverlaid blocks in stack i */
+/* into stack j */
+int lower_bound2_pair(problem_t *problem, state_t *cstate,
+                      lb_state_t *clb_state, int i, int j,
+                      int max_clean_priority, uchar all_dirty)
+{
+  int k, l;
+  stack_state_t *stack = cstate->stack;
+
+  k = clb_state->removal_for_supply[j][stack[i].misoverlay_priority];
+
+  if(all_dirty == True) {
+    /* all the stacks are dirty */
+    l = 0;
+    if(stack[j].n_clean > k
+       && cstate->block[j][stack[j].n_clean - k - 1].priority
+       > max_clean_priority) {
+      l = 1;
+    }
+
+    if(i == j) {
+      if(stack[j].n_tier - stack[j].n_clean
+         > clb_state->lbBX - cstate->n_misoverlay) {
+        ++l;
+      }
+    } else if(stack[j].misoverlay_priority > max_clean_priority) {
+      l = 1;
+    }
+
+    return(k + l);
+  }
+
+  if(i != j && stack[j].n_clean < stack[j].n_tier
+     && stack[i].misoverlay_priority > max_clean_priority) {
+    ++k;
+  } else if(stack[j].n_clean > k
+            && cstate->block[j][stack[j].n_clean - k - 1].priority
+            > max_clean_priority) {
+    ++k;
+  }
+
+  if(i == j) {
+    ++k;
+  }
+
+  return(k);
+}
 #endif /* LOWER_BOUND2 */
@@ -33,11 +33,105 @@
  */
 #ifndef SOLVE_H
 #define SOLVE_H
+#include <stdio.h>
 #include "define.h"
+#include "pdb.h"
 #include "problem.h"
 #include "solution.h"
 #include "solve.h"
 
+/*
+ * search state and working area, reused by the searches on it
+ * a context is used by one thread at a time, and searches on different
+ * contexts may run concurrently on different threads.  the context owns
+ * the settings of its search (solver_ctx_set_option()) and all of its
+ * working areas, including those of the lower bounds, the heuristics,
+ * endgame(), the flow bound and the pattern databases, which are built
+ * for the problem when the search starts and freed when it ends.  the
+ * parallel heuristics, the lookahead and the speculative iterations of
+ * a search run on threads of their own (solver_ctx_set_threads()) with
+ * working areas of their own, and share the pattern databases of the
+ * search.
+ *
+ */
+typedef struct solver_ctx solver_ctx_t;
+
+/* settings of a search (solver_default_option(): the global settings */
+/* declared in problem.h, which the options of main.c set) */
+typedef struct {
+  uchar verbose;
+  /* time for GRASP at the root node */
+  double grasp_time;
+  /* pilot method at the root node */
+  uchar pilot_method;
+  /* limited discrepancy search */
+  uchar lds_mode;
+  /* weight (>= 1) of the lower bound for pruning */
+  double lb_weight;
+  /* number of consecutive iterations run concurrently */
+  int n_speculation;
+  /* hybrid of IDA* and depth-first b&b */
+  uchar hybrid_mode;
+  /* restarts every restart_unit*luby(i) nodes (0: no restart) */
+  int restart_unit;
+  /* depth of the lookahead for the root lower bound (0: none) */
+  int lookahead_depth;
+  /* exact endgame with at most endgame_threshold misoverlaid blocks */
+  int endgame_threshold;
+  /* assignment lower bound up to depth flow_depth */
+  int flow_depth;
+  /* number of pattern databases built for the search (0: none), */
+  /* stored in pdb_dir (NULL: not stored) */
+  int n_pdb;
+  char *pdb_dir;
+} solver_option_t;
+
+/* events of a search */
+enum {SOLUTION_EVENT, ITERATION_EVENT, BOUND_EVENT};
+
+typedef struct {
+  int type;
+  /* SOLUTION_EVENT: the improved solution and where it is found */
+  /* ("heuristics", "grasp", "pilot", "search" or "endgame") */
+  solution_t *solution;
+  char *source;
+  /* SOLUTION_EVENT: size of the solution, ITERATION_EVENT: no solution */
+  /* of at most ub relocations exists */
+  int ub;
+  /* lower bound proven so far (raised on BOUND_EVENT) */
+  int lb;
+  /* time from the start of the search */
+  double time;
+} solver_event_t;
+
+/* callback(arg, problem, event) on an event of the search */
+typedef void (*solver_callback_t)(void *, problem_t *, solver_event_t *);
+
+solver_ctx_t *create_solver_ctx(void);
+void free_solver_ctx(solver_ctx_t *);
+ulint solver_ctx_nodes(solver_ctx_t *);
+int solver_ctx_lower_bound(solver_ctx_t *);
+void solver_ctx_set_limit(solver_ctx_t *, double, int);
+void solver_ctx_set_threads(solver_ctx_t *, int);
+void solver_ctx_set_callback(solver_ctx_t *, solver_callback_t, void *);
+void solver_default_option(solver_option_t *);
+void solver_ctx_set_option(solver_ctx_t *, solver_option_t *);
+void reserve_solver_ctx(solver_ctx_t *, int, int, int);
+uchar solve_ctx(solver_ctx_t *, problem_t *, solution_t *);
 uchar solve(problem_t *, solution_t *);
+int start_iteration(solver_ctx_t *, problem_t *, int);
+uchar run_iteration(solver_ctx_t *, problem_t *, solution_t *, ulint);
+uchar split_iteration(solver_ctx_t *, problem_t *, solver_ctx_t *);
+uchar save_iteration(solver_ctx_t *, problem_t *, FILE *);
+uchar load_iteration(solver_ctx_t *, problem_t *, FILE *);
+void end_iteration(solver_ctx_t *);
+
+/* working area of lower_bound() for a problem */
+typedef struct lb_work lb_work_t;
+
+lb_work_t *create_lb_work(problem_t *, pdb_t *);
+void free_lb_work(lb_work_t *);
+int lower_bound(lb_work_t *, problem_t *, state_t *, lb_state_t *, int,
+                uchar);
 
 #endif /* !SOLVE_H */
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2016-2017 Shunji Tanaka and Kevin Tierney.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials
+ *      provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  $Id$
+ *  $Revision$
+ *  $Date$
+ *  $Author$
+ *
+ */
+#include <stdio.h>
+#include "define.h"
+#include "problem.h"
+#include "solution.h"
+#include "solve.h"
+#include "stream.h"
+
+/*
+ * the events of the search are written to fp = (FILE *) arg one JSON
+ * object per line, flushed as they happen:
+ *   {"event":"solution","source":s,"relocations":n,"time":t,
+ *    "moves":[[src,dst],...]}
+ *   {"event":"iteration","ub":ub,"lb":lb,"time":t}
+ *   {"event":"bound","lb":lb,"time":t}
+ * the stacks are numbered from 1 as in print_solution().
+ *
+ */
+void stream_event(void *arg, problem_t *problem, solver_event_t *event)
+{
+  FILE *fp = (FILE *) arg;
+
+  switch(event->type) {
+  case SOLUTION_EVENT:
+    stream_solution(fp, event->solution, event->source, event->time);
+    return;
+  case ITERATION_EVENT:
+    fprintf(fp, "{\"event\":\"iteration\",\"ub\":%d,\"lb\":%d,"
+            "\"time\":%.3f}\n", event->ub, event->lb, event->time);
+    break;
+  case BOUND_EVENT:
+    fprintf(fp, "{\"event\":\"bound\",\"lb\":%d,\"time\":%.3f}\n",
+            event->lb, event->time);
+    break;
+  }
+  fflush(fp);
+}
+
+void stream_solution(FILE *fp, solution_t *solution, char *source,
+                     double time)
+{
+  int i;
+
+  fprintf(fp, "{\"event\":\"solution\",\"source\":\"%s\","
+          "\"relocations\":%d,\"time\":%.3f,\"moves\":[", source,
+          solution->n_relocation, time);
+  for(i = 0; i < solution->n_relocation; ++i) {
+    fprintf(fp, "%s[%d,%d]", (i > 0)?",":"",
+            solution->relocation[i].src + 1, solution->relocation[i].dst + 1);
+  }
+  fprintf(fp, "]}\n");
+  fflush(fp);
+}
+
+/*
+ * the last line of the stream
+ * {"event":"result","status":"optimal"|"feasible"|"none",
+ *  "relocations":n,"lb":lb,"nodes":nodes,"time":t}
+ *
+ */
+void stream_result(FILE *fp, solution_t *solution, uchar ret, int lb,
+                   ulint n_node, double time)
+{
+  if(solution->n_relocation > MAX_N_RELOCATION) {
+    fprintf(fp, "{\"event\":\"result\",\"status\":\"none\",\"lb\":%d,"
+            "\"nodes\":%llu,\"time\":%.3f}\n", lb, n_node, time);
+  } else {
+    fprintf(fp, "{\"event\":\"result\",\"status\":\"%s\","
+            "\"relocations\":%d,\"lb\":%d,\"nodes\":%llu,\"time\":%.3f}\n",
+            (ret == True)?"optimal":"feasible", solution->n_relocation,
+            (ret == True)?solution->n_relocation:lb, n_node, time);
+  }
+  fflush(fp);
+}
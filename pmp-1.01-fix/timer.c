@@ -37,35 +37,16 @@
 #include "problem.h"
 #define INCLUDE_SYSTEM_TIME
 
+static double current_time(void);
+
 void timer_start(problem_t *problem)
 {
-#ifdef USE_CLOCK
-  problem->stime = (double) clock()/(double) CLOCKS_PER_SEC;
-#else  /* !USE_CLOCK */
-  struct rusage ru;
-
-  getrusage(RUSAGE_SELF, &ru);
-  problem->stime = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0;
-#ifdef INCLUDE_SYSTEM_TIME
-  problem->stime += ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
-#endif /* INCLUDE_SYSTEM_TIME */
-#endif /* USE_CLOCK */
+  problem->stime = current_time();
 }
 
 void set_time(problem_t *problem)
 {
-#ifdef USE_CLOCK
-  problem->time = (double) clock()/(double) CLOCKS_PER_SEC;
-#else  /* !USE_CLOCK */
-  struct rusage ru;
-
-  getrusage(RUSAGE_SELF, &ru);
-  problem->time = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0;
-#ifdef INCLUDE_SYSTEM_TIME
-  problem->time += ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
-#endif /* INCLUDE_SYSTEM_TIME */
-#endif /* !USE_CLOCK */
-  problem->time -= problem->stime;
+  problem->time = current_time() - problem->stime;
 
   if(problem->time < 0.0) {
     problem->time = 0.0;
@@ -73,6 +54,18 @@ void set_time(problem_t *problem)
 }
 
 double get_time(problem_t *problem)
+{
+  double t = current_time() - problem->stime;
+
+  return((t < 0.0)?0.0:t);
+}
+
+/*
+ * cpu time of the process, or elapsed time if wall_clock == True
+ * (problems solved concurrently share the cpu time of the process)
+ *
+ */
+double current_time(void)
 {
   double t;
 #ifdef USE_CLOCK
@@ -80,13 +73,19 @@ double get_time(problem_t *problem)
 #else  /* !USE_CLOCK */
   struct rusage ru;
 
+  if(wall_clock == True) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double) ts.tv_sec + (double) ts.tv_nsec/1000000000.0);
+  }
+
   getrusage(RUSAGE_SELF, &ru);
   t = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0;
 #ifdef INCLUDE_SYSTEM_TIME
   t += ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
 #endif /* INCLUDE_SYSTEM_TIME */
 #endif /* !USE_CLOCK */
-  t -= problem->stime;
 
-  return((t < 0.0)?0.0:t);
+  return(t);
 }
@@ -40,6 +40,7 @@
 #ifdef USE_CLOCK
 #include <time.h>
 #else  /* !USE_CLOCK */
+#include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #endif /* !USE_CLOCK */